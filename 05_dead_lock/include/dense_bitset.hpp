@@ -0,0 +1,113 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief 按 64 位字存储的变长位集
+ *
+ * 用于以稠密编号索引的集合（线程持有的锁、锁的持有线程等）：
+ * - 插入和删除只改一个字，容量足够时不分配内存
+ * - 交集、并集逐字计算，编译器可向量化
+ */
+class DenseBitset
+{
+private:
+    std::vector<uint64_t> words;
+
+public:
+    /**
+     * @brief 置位，必要时扩容
+     */
+    void set(size_t i)
+    {
+        if (i / 64 >= words.size())
+        {
+            words.resize(i / 64 + 1, 0);
+        }
+        words[i / 64] |= uint64_t(1) << (i % 64);
+    }
+
+    void reset(size_t i)
+    {
+        if (i / 64 < words.size())
+        {
+            words[i / 64] &= ~(uint64_t(1) << (i % 64));
+        }
+    }
+
+    bool test(size_t i) const
+    {
+        return i / 64 < words.size() && (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    bool any() const
+    {
+        for (uint64_t word : words)
+        {
+            if (word != 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 清空所有位，保留容量
+     */
+    void clear()
+    {
+        for (uint64_t &word : words)
+        {
+            word = 0;
+        }
+    }
+
+    /**
+     * @brief 并入另一个位集
+     */
+    DenseBitset &operator|=(const DenseBitset &other)
+    {
+        if (other.words.size() > words.size())
+        {
+            words.resize(other.words.size(), 0);
+        }
+        for (size_t i = 0; i < other.words.size(); ++i)
+        {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    /**
+     * @brief 两个位集是否有交集
+     */
+    bool intersects(const DenseBitset &other) const
+    {
+        size_t n = words.size() < other.words.size() ? words.size() : other.words.size();
+        uint64_t common = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            common |= words[i] & other.words[i];
+        }
+        return common != 0;
+    }
+
+    /**
+     * @brief 按升序对每个置位的下标调用 f
+     */
+    template <class F>
+    void forEach(F f) const
+    {
+        for (size_t w = 0; w < words.size(); ++w)
+        {
+            uint64_t word = words[w];
+            while (word != 0)
+            {
+                f(w * 64 + static_cast<size_t>(__builtin_ctzll(word)));
+                word &= word - 1;
+            }
+        }
+    }
+};
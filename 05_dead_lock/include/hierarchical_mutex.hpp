@@ -2,6 +2,10 @@
 #include <mutex>
 #include <stdexcept>
 #include <climits>
+#include <cstddef>
+#include <vector>
+#include "hold_budget.hpp"
+#include "lock_order.hpp"
 
 /**
  * @brief 分层互斥锁
@@ -10,18 +14,86 @@
  * - 每个锁都有一个层级编号
  * - 只能按照从高层级到低层级的顺序获取锁
  * - 防止死锁的一种方法
+ *
+ * 每个线程用一个有界栈记录持有的分层锁（锁、层级、获取位置），
+ * 栈中层级严格递减，栈顶即当前最低层级；允许不按获取的逆序释放。
+ * 在 I/O、等待 future 等阻塞点调用 assertNoLocksHeld()，可以发现跨阻塞调用持锁。
+ *
+ * 也可以绑定到 LockOrder 中的锁类，层级由顺序表导出，加锁时按顺序表检查而不是比较层级。
+ * 导出的层级是从 1 开始的小整数，不要与手工指定层级的锁混用。
  */
 class HierarchicalMutex
 {
+public:
+    /**
+     * @brief 当前线程持有的一个分层锁
+     */
+    struct HeldLock
+    {
+        const HierarchicalMutex *mutex;
+        unsigned long level;
+        const char *file; // 获取位置；经由 std::lock_guard 等获取时为标准库头文件
+        int line;
+    };
+
+    static constexpr size_t max_held = 16; // 每个线程最多同时持有的分层锁数
+
 private:
     std::mutex mutex;
     const unsigned long hierarchy_level;
-    // 线程局部存储，记录当前线程的上一个锁的层级
-    inline static thread_local unsigned long previous_hierarchy_level = ULONG_MAX;
+    HoldBudget::Timer hold_timer; // 持有时间预算，未设置时不计时
+    const LockOrder *lock_order = nullptr; // 绑定的顺序表，为空时按层级检查
+    LockOrder::ClassId lock_class = 0;
+
+    struct HeldStack
+    {
+        HeldLock entries[max_held];
+        size_t size = 0;
+    };
+    // 线程局部存储，记录当前线程持有的分层锁
+    static thread_local HeldStack held;
+
+    static unsigned long currentLevel();
+    void push(const char *file, int line);
 
 public:
     explicit HierarchicalMutex(unsigned long level);
-    void lock();
+
+    /**
+     * @brief 绑定到顺序表中的锁类，顺序表需要比锁活得更久
+     * @throws std::invalid_argument 如果锁类未声明
+     */
+    HierarchicalMutex(const LockOrder &order, const std::string &lock_class);
+
+    /**
+     * @throws std::runtime_error 如果违反层级约束（或顺序表）或持有的锁超过 max_held
+     */
+    void lock(const char *file = __builtin_FILE(), int line = __builtin_LINE());
     void unlock();
-    bool try_lock();
-};
\ No newline at end of file
+    bool try_lock(const char *file = __builtin_FILE(), int line = __builtin_LINE());
+
+    unsigned long level() const { return hierarchy_level; }
+
+    /**
+     * @brief 设置持有时间预算，应在未被持有时调用；传入空指针取消
+     */
+    void setHoldBudget(const HoldBudget *budget, const char *name = nullptr);
+
+    /**
+     * @brief 当前线程是否持有该锁
+     */
+    bool isHeldByCurrentThread() const;
+
+    /**
+     * @brief 当前线程持有的分层锁，按获取顺序
+     */
+    static std::vector<HeldLock> heldLocks();
+    static size_t heldCount() { return held.size; }
+
+    /**
+     * @brief 在阻塞点检查当前线程没有持有分层锁
+     * @param where 阻塞点的描述，写入异常信息
+     * @throws std::logic_error 列出持有的锁及其获取位置
+     */
+    static void assertNoLocksHeld(const char *where);
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <thread>
+
+/**
+ * @brief 锁持有时间预算
+ *
+ * 一个预算可以分配给多个 TrackedMutex / HierarchicalMutex，锁被持有超过预算时，
+ * 在释放后（锁外）调用回调报告锁、持有线程和持有时长。
+ * 每 sample_period 次获取只计时一次，其余获取只增加一个计数，开销可以忽略。
+ * 预算对象需要比使用它的锁活得更久。
+ */
+class HoldBudget
+{
+public:
+    /**
+     * @brief 一次超出预算的持有
+     */
+    struct Violation
+    {
+        const void *lock;                 // 锁对象地址
+        const char *name;                 // 分配预算时给出的名字，可能为空
+        std::thread::id holder;           // 持有（并释放）锁的线程
+        std::chrono::nanoseconds held;    // 持有时长
+        std::chrono::nanoseconds budget;  // 预算
+    };
+
+    using Callback = std::function<void(const Violation &)>;
+
+    /**
+     * @param budget 允许的持有时长
+     * @param callback 超出预算时调用，可能在任何释放锁的线程上执行
+     * @param sample_period 每多少次获取计时一次，1 表示每次都计时
+     */
+    HoldBudget(std::chrono::nanoseconds budget, Callback callback, unsigned sample_period = 1);
+
+    /**
+     * @brief 调用回调，锁应已释放
+     */
+    void report(const Violation &violation) const { callback(violation); }
+
+    /**
+     * @brief 每个锁内嵌的计时状态，只在持有锁时读写，由锁本身保护
+     */
+    class Timer
+    {
+    private:
+        const HoldBudget *budget = nullptr;
+        const char *name = nullptr;
+        unsigned acquisitions = 0;
+        bool timing = false;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        void assign(const HoldBudget *b, const char *n);
+
+        /**
+         * @brief 获取锁之后调用
+         */
+        void acquired()
+        {
+            if (budget != nullptr && acquisitions++ % budget->sample_period == 0)
+            {
+                timing = true;
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        /**
+         * @brief 释放锁之前调用
+         * @return 本次持有超出预算时返回应通知的预算并填写 violation，否则为空
+         */
+        const HoldBudget *released(const void *lock, Violation &violation)
+        {
+            return timing ? finish(lock, violation) : nullptr;
+        }
+
+    private:
+        const HoldBudget *finish(const void *lock, Violation &violation);
+    };
+
+private:
+    const std::chrono::nanoseconds budget;
+    const Callback callback;
+    const unsigned sample_period;
+};
@@ -0,0 +1,150 @@
+#pragma once
+#include "dense_bitset.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief 声明式的全局加锁顺序表
+ *
+ * 给锁划分具名的锁类，声明“持有 A 时可以获取 B”（A 在 B 之前），
+ * 不必为每个锁手工分配 HierarchicalMutex 的数字层级：
+ * - 顺序可以来自 constexpr 规则表，也可以来自启动时读取的配置文件
+ * - 构造时求出传递闭包存入位矩阵，加锁时的检查只是一次位测试
+ * - 声明中出现环时构造失败
+ * - 检查方式可在运行时切换：Fail 抛出异常，LogOnly 只记录，Off 不检查
+ *
+ * 每个线程记录持有的已绑定锁，获取时和每个持有的同表锁比较（最多 max_held 次位测试）。
+ * Off 模式也记录，运行中切换到 Fail 或 LogOnly 时已持有的锁同样参与检查。
+ *
+ * 配置文件每行一条链，例如 “config -> cache -> db”，单独一个名字只声明锁类，
+ * # 之后为注释。
+ */
+class LockOrder
+{
+public:
+    using ClassId = uint32_t;
+
+    enum class Mode
+    {
+        Fail,    // 违反顺序时抛出 std::runtime_error，不获取锁
+        LogOnly, // 违反顺序时调用日志回调，照常获取锁
+        Off      // 不检查，仍记录持有的锁
+    };
+
+    /**
+     * @brief 一条顺序规则：before 类的锁可以在持有时再获取 after 类的锁
+     */
+    struct Rule
+    {
+        const char *before;
+        const char *after;
+    };
+
+    /**
+     * @throws std::invalid_argument 如果规则中有环
+     */
+    explicit LockOrder(const std::vector<Rule> &rules, Mode mode = Mode::Fail);
+
+    template <size_t N>
+    explicit LockOrder(const Rule (&rules)[N], Mode mode = Mode::Fail)
+        : LockOrder(std::vector<Rule>(rules, rules + N), mode) {}
+
+    LockOrder(const LockOrder &) = delete;
+    LockOrder &operator=(const LockOrder &) = delete;
+
+    /**
+     * @brief 解析配置
+     * @throws std::invalid_argument 语法错误（带行号）或有环
+     */
+    static std::unique_ptr<LockOrder> parse(std::istream &in, Mode mode = Mode::Fail);
+
+    /**
+     * @brief 读取配置文件
+     * @throws std::runtime_error 如果文件无法打开
+     */
+    static std::unique_ptr<LockOrder> load(const std::string &path, Mode mode = Mode::Fail);
+
+    /**
+     * @throws std::invalid_argument 如果锁类未声明
+     */
+    ClassId classId(const std::string &name) const;
+    const std::string &className(ClassId id) const { return names[id]; }
+    size_t classCount() const { return names.size(); }
+
+    /**
+     * @brief 持有 held 类的锁时能否获取 next 类的锁，O(1)
+     */
+    bool allowed(ClassId held, ClassId next) const { return reach[held].test(next); }
+
+    /**
+     * @brief 由顺序导出的层级：A 在 B 之前则 level(A) > level(B)，可直接用作 HierarchicalMutex 的层级
+     */
+    unsigned long level(ClassId id) const { return levels[id]; }
+
+    void setMode(Mode m) { current_mode.store(m, std::memory_order_relaxed); }
+    Mode mode() const { return current_mode.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief LogOnly 模式下的日志回调，默认写到标准错误
+     */
+    void setLogger(std::function<void(const std::string &)> logger);
+
+    /**
+     * @brief 当前线程获取锁之前调用，违反顺序时按模式处理
+     * @param lock 锁对象地址，用于释放时找到对应记录
+     * @throws std::runtime_error Fail 模式下违反顺序，或持有的已绑定锁过多
+     */
+    void beforeAcquire(const void *lock, ClassId id) const;
+
+    /**
+     * @brief 同 beforeAcquire，Fail 模式下违反顺序时返回 false 而不抛出，供 try_lock 使用
+     */
+    bool tryBeforeAcquire(const void *lock, ClassId id) const;
+
+    /**
+     * @brief 获取失败（如 try_lock 失败）时撤销 beforeAcquire 的记录
+     */
+    void acquireFailed(const void *lock) const { release(lock); }
+
+    /**
+     * @brief 当前线程释放锁时调用，可以不按获取的逆序
+     */
+    void release(const void *lock) const;
+
+    static constexpr size_t max_held = 16; // 每个线程最多同时持有的已绑定锁数
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, ClassId> ids;
+    std::vector<DenseBitset> reach;  // reach[a] 为可在持有 a 时获取的锁类（传递闭包）
+    std::vector<unsigned long> levels;
+    std::atomic<Mode> current_mode;
+    std::function<void(const std::string &)> log;
+
+    struct HeldClass
+    {
+        const LockOrder *order;
+        const void *lock;
+        ClassId id;
+    };
+
+    struct HeldStack
+    {
+        HeldClass entries[max_held];
+        size_t size;
+    };
+    // 线程局部存储，记录当前线程持有的已绑定锁
+    static thread_local HeldStack held;
+
+    explicit LockOrder(Mode mode);
+    ClassId intern(const std::string &name);
+    bool record(const void *lock, ClassId id, bool throw_on_violation) const;
+    void build(const std::vector<std::pair<ClassId, ClassId>> &edges);
+};
@@ -0,0 +1,355 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 无锁对象池，复用构造代价高的对象（如各自带一个 std::mutex 的 Resource）
+ *
+ * - 对象在池创建时一次性构造，之后只借出和归还，不再构造和释放
+ * - 全局空闲链表是以下标链接的 Treiber 栈，栈顶为“下标 + 版本号”的 64 位原子量，
+ *   每次修改版本号加一，避免 ABA 问题
+ * - 每个线程有本地缓存，借还通常不触碰共享状态；缓存空时从全局链表批量取一批，
+ *   缓存过满时把一批连成链一次归还
+ * - 借出的对象由 Lease 持有，析构时自动归还
+ *
+ * 对象归还时保持原样，不会重置状态。其它线程缓存中的空闲对象暂时借不到，
+ * 因此容量应略大于峰值并发借用数。
+ *
+ * @tparam T 对象类型，不要求可移动
+ */
+template <class T>
+class ObjectPool
+{
+private:
+    static constexpr uint32_t nil = UINT32_MAX;
+
+    /**
+     * @brief 对象和空闲链表；池和借出的 Lease 持有它，全部释放后销毁对象
+     */
+    struct Core
+    {
+        size_t capacity;
+        const size_t batch;
+        const uint64_t generation; // 进程内唯一，线程缓存用它识别池，不受地址复用影响
+        std::unique_ptr<typename std::aligned_storage<sizeof(T), alignof(T)>::type[]> storage;
+        std::unique_ptr<std::atomic<uint32_t>[]> next; // 空闲链表中的后继下标
+        std::atomic<uint64_t> head;                    // 高 32 位版本号，低 32 位栈顶下标
+
+        Core(size_t capacity, size_t batch)
+            : capacity(capacity), batch(batch), generation(nextGeneration()),
+              storage(new typename std::aligned_storage<sizeof(T), alignof(T)>::type[capacity]),
+              next(new std::atomic<uint32_t>[capacity]), head(nil) {}
+
+        ~Core()
+        {
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                object(static_cast<uint32_t>(i))->~T();
+            }
+        }
+
+        static uint64_t nextGeneration()
+        {
+            static std::atomic<uint64_t> counter{0};
+            return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+        }
+
+        T *object(uint32_t index)
+        {
+            return std::launder(reinterpret_cast<T *>(&storage[index]));
+        }
+
+        static uint64_t pack(uint32_t index, uint32_t tag)
+        {
+            return (static_cast<uint64_t>(tag) << 32) | index;
+        }
+
+        /**
+         * @brief 把 first..last 的链整体压栈，last 的后继由这里设置
+         */
+        void pushChain(uint32_t first, uint32_t last)
+        {
+            uint64_t old_head = head.load(std::memory_order_relaxed);
+            do
+            {
+                next[last].store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+            } while (!head.compare_exchange_weak(old_head, pack(first, static_cast<uint32_t>(old_head >> 32) + 1),
+                                                 std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        /**
+         * @brief 一次 CAS 取出最多 count 个下标
+         *
+         * 沿链读取前 count 个结点时其它线程可能正在修改链表，读到的值可能不一致；
+         * 但任何修改都会让版本号变化，CAS 随之失败并重试，成功时读到的正是当时的链。
+         */
+        void popBatch(std::vector<uint32_t> &out, size_t count)
+        {
+            size_t base = out.size();
+            uint64_t old_head = head.load(std::memory_order_acquire);
+            while (true)
+            {
+                out.resize(base);
+                uint32_t index = static_cast<uint32_t>(old_head);
+                while (index != nil && out.size() - base < count)
+                {
+                    out.push_back(index);
+                    index = next[index].load(std::memory_order_relaxed);
+                }
+                if (out.size() == base)
+                {
+                    return;
+                }
+                if (head.compare_exchange_weak(old_head, pack(index, static_cast<uint32_t>(old_head >> 32) + 1),
+                                               std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * @brief 把 items 末尾的 count 个下标连成链一次归还
+         */
+        void pushBatch(std::vector<uint32_t> &items, size_t count)
+        {
+            size_t begin = items.size() - count;
+            for (size_t i = begin; i + 1 < items.size(); ++i)
+            {
+                next[items[i]].store(items[i + 1], std::memory_order_relaxed);
+            }
+            pushChain(items[begin], items.back());
+            items.resize(begin);
+        }
+    };
+
+    /**
+     * @brief 线程本地缓存，只弱引用池
+     *
+     * 池销毁后缓存不会让对象继续存活；线程退出时把剩余对象归还仍存在的池，
+     * 已销毁的池对应的缓存在下一次新建缓存时清除。
+     */
+    struct Cache
+    {
+        uint64_t generation;
+        std::weak_ptr<Core> core;
+        std::vector<uint32_t> items;
+
+        ~Cache()
+        {
+            if (!items.empty())
+            {
+                if (std::shared_ptr<Core> alive = core.lock())
+                {
+                    alive->pushBatch(items, items.size());
+                }
+            }
+        }
+    };
+
+    // 最近使用的缓存，以及线程的缓存表是否已析构；两者都可平凡析构，线程退出的任何阶段都能安全读取
+    static inline thread_local Cache *last = nullptr;
+    static inline thread_local bool caches_destroyed = false;
+
+    /**
+     * @brief 线程的缓存表，析构时清空 last，之后的借还绕过缓存
+     */
+    struct CacheList
+    {
+        std::vector<std::unique_ptr<Cache>> caches;
+
+        ~CacheList()
+        {
+            last = nullptr;
+            caches_destroyed = true;
+        }
+    };
+
+    /**
+     * @return 当前线程的缓存；线程退出时缓存表已析构（如其它 thread_local 持有的 Lease 此时才归还）返回空
+     */
+    static Cache *cacheFor(const std::shared_ptr<Core> &core)
+    {
+        if (caches_destroyed)
+        {
+            return nullptr;
+        }
+        if (last != nullptr && last->generation == core->generation)
+        {
+            return last;
+        }
+
+        // 每个线程通常只用到少数几个池，线性查找即可
+        static thread_local CacheList list;
+        std::vector<std::unique_ptr<Cache>> &caches = list.caches;
+        for (auto &cache : caches)
+        {
+            if (cache->generation == core->generation)
+            {
+                last = cache.get();
+                return last;
+            }
+        }
+
+        // 清除已销毁的池的缓存，反复创建和销毁池的长寿线程不会积累
+        caches.erase(std::remove_if(caches.begin(), caches.end(),
+                                    [](const std::unique_ptr<Cache> &cache)
+                                    { return cache->core.expired(); }),
+                     caches.end());
+        caches.push_back(std::unique_ptr<Cache>(new Cache{core->generation, core, {}}));
+        caches.back()->items.reserve(core->batch * 2);
+        last = caches.back().get();
+        return last;
+    }
+
+    /**
+     * @brief 下标用 32 位存储且 nil 为链表结束标记，容量必须小于 UINT32_MAX
+     */
+    static size_t checkedCapacity(size_t capacity)
+    {
+        if (capacity >= nil)
+        {
+            throw std::length_error("ObjectPool: capacity must be less than UINT32_MAX");
+        }
+        return capacity;
+    }
+
+    std::shared_ptr<Core> core;
+
+public:
+    /**
+     * @brief 借出的对象，析构时归还；只能移动
+     */
+    class Lease
+    {
+    private:
+        std::shared_ptr<Core> core;
+        uint32_t index = nil;
+
+        friend class ObjectPool;
+        Lease(std::shared_ptr<Core> c, uint32_t i) : core(std::move(c)), index(i) {}
+
+    public:
+        Lease() = default;
+        Lease(Lease &&other) noexcept : core(std::move(other.core)), index(other.index) { other.index = nil; }
+        Lease &operator=(Lease &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                core = std::move(other.core);
+                index = other.index;
+                other.index = nil;
+            }
+            return *this;
+        }
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease() { reset(); }
+
+        /**
+         * @brief 提前归还
+         */
+        void reset()
+        {
+            if (index == nil)
+            {
+                return;
+            }
+            Cache *cache = cacheFor(core);
+            if (cache == nullptr)
+            {
+                core->pushChain(index, index);
+            }
+            else
+            {
+                cache->items.push_back(index);
+                if (cache->items.size() >= core->batch * 2)
+                {
+                    core->pushBatch(cache->items, core->batch);
+                }
+            }
+            index = nil;
+            core.reset();
+        }
+
+        explicit operator bool() const { return index != nil; }
+        T *get() const { return index == nil ? nullptr : core->object(index); }
+        T *operator->() const { return get(); }
+        T &operator*() const { return *get(); }
+    };
+
+    /**
+     * @param capacity 对象个数，必须小于 UINT32_MAX，否则抛出 std::length_error
+     * @param factory 以下标调用，返回用于构造第 i 个对象的值（可直接返回 T 的纯右值）
+     * @param batch 线程缓存每次与全局链表交换的对象数
+     */
+    template <class Factory>
+    ObjectPool(size_t capacity, Factory factory, size_t batch = 16)
+        : core(std::make_shared<Core>(checkedCapacity(capacity), batch > 0 ? batch : 1))
+    {
+        size_t constructed = 0;
+        try
+        {
+            for (; constructed < capacity; ++constructed)
+            {
+                new (&core->storage[constructed]) T(factory(constructed));
+            }
+        }
+        catch (...)
+        {
+            while (constructed > 0)
+            {
+                core->object(static_cast<uint32_t>(--constructed))->~T();
+            }
+            // Core 的析构会再次销毁对象，这里改为空池
+            core->capacity = 0;
+            throw;
+        }
+
+        // 按下标顺序连成空闲链表
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            core->next[i].store(i + 1 < capacity ? static_cast<uint32_t>(i + 1) : nil, std::memory_order_relaxed);
+        }
+        core->head.store(capacity > 0 ? Core::pack(0, 0) : nil, std::memory_order_release);
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    /**
+     * @brief 借出一个对象
+     * @return 池已耗尽时返回空的 Lease
+     */
+    Lease acquire()
+    {
+        Cache *cache = cacheFor(core);
+        if (cache == nullptr)
+        {
+            std::vector<uint32_t> one;
+            core->popBatch(one, 1);
+            return one.empty() ? Lease() : Lease(core, one[0]);
+        }
+        if (cache->items.empty())
+        {
+            core->popBatch(cache->items, core->batch);
+            if (cache->items.empty())
+            {
+                return Lease();
+            }
+        }
+        uint32_t index = cache->items.back();
+        cache->items.pop_back();
+        return Lease(core, index);
+    }
+
+    size_t capacity() const { return core->capacity; }
+};
@@ -1,8 +1,15 @@
 #pragma once
 #include <mutex>
-#include <map>
-#include <set>
+#include <chrono>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <thread>
+#include "dense_bitset.hpp"
 
 /**
  * @brief 资源分配图类，用于死锁检测
@@ -11,33 +18,254 @@
  * - 记录每个线程持有的锁
  * - 记录每个线程等待的锁
  * - 通过环检测算法发现死锁
+ *
+ * 除互斥锁外，条件变量和 future 也可作为资源登记（见 TrackedEvent）：
+ * 可能发出通知或产生结果的线程视为“持有”该资源，等待者视为“等待”该资源，
+ * 因此“持锁等待通知、而通知方在等这把锁”这类混合环同样能被检测到。
+ *
+ * 线程和锁都使用稠密的整数编号，图以位集的行存储：
+ * - 线程编号保存在 thread_local 中，线程退出后回收复用
+ * - 锁编号在 TrackedMutex 构造时注册一次，保存在包装器中
+ * - 获取、释放、等待只改动位集中的一位，容量足够时不分配内存
+ *
+ * 另外每个线程把自己持有和等待的资源及起始时间发布到固定大小的槽位（seqlock），
+ * snapshot() 只读槽位、不加锁，可在进程卡住时导出 DOT/JSON 查看谁持有什么。
  */
 class ResourceGraph
 {
-private:
-    std::mutex graph_mutex;
+public:
+    using LockId = uint32_t;
+    using ThreadIndex = uint32_t;
+
+    /**
+     * @brief 资源类型
+     */
+    enum class ResourceKind
+    {
+        Mutex,
+        ConditionVariable, // 持有者为可能发出通知的线程
+        Future             // 持有者为负责产生结果的线程
+    };
 
-    // 记录线程持有的锁：thread_id -> set<mutex*>
-    std::map<std::thread::id, std::set<std::mutex *>> thread_holds;
+    /**
+     * @brief 报告中引用的资源
+     */
+    struct ResourceRef
+    {
+        const void *object; // 互斥锁、条件变量或 future 的地址
+        ResourceKind kind;
+    };
+
+    /**
+     * @param max_threads 快照可覆盖的线程编号上限，编号更大的线程仍参与死锁检测，但不出现在快照中
+     */
+    explicit ResourceGraph(size_t max_threads = 256);
+    ~ResourceGraph();
 
-    // 记录线程等待的锁：thread_id -> set<mutex*>
-    std::map<std::thread::id, std::set<std::mutex *>> thread_waits;
+    ResourceGraph(const ResourceGraph &) = delete;
+    ResourceGraph &operator=(const ResourceGraph &) = delete;
 
     /**
-     * @brief 使用深度优先搜索检测环
-     * @param current 当前检查的线程ID
-     * @param visited 已访问的线程集合
-     * @param recursion_stack 当前递归栈中的线程集合
-     * @return 是否存在环
+     * @brief 当前线程的稠密编号（所有资源图共用）
      */
-    bool hasCycle(std::thread::id current,
-                  std::set<std::thread::id> &visited,
-                  std::set<std::thread::id> &recursion_stack);
+    static ThreadIndex currentThread();
 
-public:
+    /**
+     * @brief 为互斥锁分配编号并增加引用，同一个互斥锁总是得到同一编号
+     */
+    LockId registerLock(std::mutex *mtx);
+
+    /**
+     * @brief 为任意对象分配资源编号并增加引用，用 unregisterLock 释放
+     */
+    LockId registerResource(const void *object, ResourceKind kind);
+
+    /**
+     * @brief 减少引用，最后一个引用释放后编号可被复用
+     */
+    void unregisterLock(LockId id);
+
+    void acquireLock(LockId id);
+    void releaseLock(LockId id);
+    void waitForLock(LockId id);
+    void stopWaiting(LockId id);
+
+    // 以指针标识锁的接口：首次使用时注册编号，此后一直保留
     void acquireLock(std::mutex *mtx);
     void releaseLock(std::mutex *mtx);
     void waitForLock(std::mutex *mtx);
     void stopWaiting(std::mutex *mtx);
+
     bool hasDeadlock();
-};
\ No newline at end of file
+
+    /**
+     * @brief 死锁中的一个线程
+     */
+    struct DeadlockedThread
+    {
+        ThreadIndex index;                          // 稠密编号
+        std::thread::id id;                         // 线程标识
+        std::vector<ResourceRef> held;              // 持有的锁（及负责通知的事件）
+        std::vector<ResourceRef> waiting_for;       // 等待的锁或事件
+        std::vector<ThreadIndex> blocked_by;        // 持有所等待的锁、且同在该死锁中的线程
+        std::chrono::steady_clock::duration waited; // 已等待的时间
+    };
+
+    /**
+     * @brief 一组互相等待的线程（等待图的一个强连通分量）
+     */
+    struct Deadlock
+    {
+        std::vector<DeadlockedThread> threads;
+    };
+
+    /**
+     * @brief 找出所有死锁
+     *
+     * 一次线性遍历（迭代实现的 Tarjan 算法）把等待图分解为强连通分量，
+     * 每个含有环的分量即一组死锁线程。不使用递归，图再深也不会栈溢出。
+     *
+     * @return 每组死锁的线程、持有和等待的锁及等待时长，无死锁时为空
+     */
+    std::vector<Deadlock> findDeadlocks();
+
+    /**
+     * @brief 某一时刻的持有和等待关系
+     */
+    struct Snapshot
+    {
+        struct Thread
+        {
+            ThreadIndex index;
+            long os_id; // 内核线程号，可与 ps、/proc 对照
+        };
+
+        /**
+         * @brief 一条持有或等待关系，duration 为已持有或已等待的时间
+         */
+        struct Edge
+        {
+            ThreadIndex thread;
+            LockId lock;
+            ResourceRef resource;
+            std::chrono::steady_clock::duration duration;
+        };
+
+        std::vector<Thread> threads; // 持有或等待任意资源的线程
+        std::vector<Edge> holds;
+        std::vector<Edge> waits;
+        bool truncated = false; // 有线程超出槽位数，或持有的资源超出槽位容量
+
+        /**
+         * @brief Graphviz 格式：线程 -> 资源 为等待，资源 -> 线程 为持有，边上标注时长
+         */
+        std::string toDot() const;
+
+        std::string toJson() const;
+    };
+
+    /**
+     * @brief 不加锁地读取所有线程发布的状态
+     *
+     * 各线程的状态分别一致；线程之间不是同一瞬间，正在变化的关系可能出现在其中一端
+     */
+    Snapshot snapshot() const;
+
+    enum class DumpFormat
+    {
+        Dot,
+        Json
+    };
+
+    /**
+     * @brief 收到信号时把快照写到文件描述符
+     *
+     * 信号处理函数只向管道写一个字节，由后台线程生成并写出快照。
+     * 同一时刻只有一个资源图可以启用，析构或 disableSignalDump() 时恢复原处理函数。
+     *
+     * @param signo 信号，默认 SIGUSR2
+     * @param fd 输出目标，默认标准错误
+     * @throws std::logic_error 如果已有资源图启用了信号导出
+     * @throws std::system_error 如果创建管道或安装处理函数失败
+     */
+    void enableSignalDump(int signo = SIGUSR2, int fd = 2, DumpFormat format = DumpFormat::Json);
+    void disableSignalDump();
+
+private:
+    /**
+     * @brief 槽位中的一条资源记录，字段均为原子量以便无锁读取
+     */
+    struct SlotEntry
+    {
+        std::atomic<LockId> lock{0};
+        std::atomic<const void *> object{nullptr};
+        std::atomic<int> kind{0};
+        std::atomic<int64_t> since{0}; // steady_clock 纳秒
+    };
+
+    /**
+     * @brief 线程发布的状态，只由所属线程写入（且持有 graph_mutex）
+     */
+    struct ThreadSlot
+    {
+        static constexpr size_t max_held = 16;
+        static constexpr size_t max_waits = 4;
+
+        std::atomic<uint64_t> sequence{0}; // 奇数表示正在写入
+        std::atomic<long> os_id{0};
+        std::atomic<uint32_t> held_count{0};
+        std::atomic<uint32_t> wait_count{0};
+        std::atomic<bool> overflow{false};
+        SlotEntry held[max_held];
+        SlotEntry waits[max_waits];
+    };
+
+    const size_t max_slots;
+    std::unique_ptr<ThreadSlot[]> slots;
+    std::atomic<uint32_t> slots_used{0}; // 出现过的最大线程编号 + 1
+    std::atomic<bool> slots_overflow{false}; // 有线程编号超出槽位数
+
+    void publishAdd(ThreadIndex thread, bool wait, LockId id);
+    void publishRemove(ThreadIndex thread, bool wait, LockId id);
+
+    // 信号导出
+    int dump_signal = -1;
+    int dump_fd = -1;
+    DumpFormat dump_format = DumpFormat::Json;
+    int dump_pipe[2] = {-1, -1};
+    struct sigaction previous_action{};
+    std::thread dump_thread;
+    void dumpLoop();
+
+    std::mutex graph_mutex;
+
+    // 线程持有的锁：thread -> 锁位集
+    std::vector<DenseBitset> thread_holds;
+
+    // 线程等待的锁：thread -> 锁位集
+    std::vector<DenseBitset> thread_waits;
+
+    // 锁的持有线程：lock -> 线程位集
+    std::vector<DenseBitset> lock_holders;
+
+    // 正在等待任意锁的线程，只有它们可能位于环上
+    DenseBitset waiting_threads;
+
+    // thread -> 线程标识和开始等待的时间，仅用于报告
+    std::vector<std::thread::id> thread_ids;
+    std::vector<std::chrono::steady_clock::time_point> wait_started;
+
+    // thread -> 行所属线程的编号分配序号，与当前线程不同说明编号已被复用
+    std::vector<uint64_t> thread_generations;
+
+    // 锁编号注册表，只在注册和注销时访问
+    std::unordered_map<const void *, LockId> lock_ids;
+    std::vector<ResourceRef> lock_resources; // lock -> 资源，已回收的编号 object 为 nullptr
+    std::vector<uint32_t> lock_refs;        // lock -> 引用数
+    std::vector<LockId> free_lock_ids;
+
+    LockId lockIdFor(const void *object, ResourceKind kind);
+    LockId pinnedLockId(std::mutex *mtx);
+    void ensureThread(ThreadIndex thread);
+    std::vector<DenseBitset> waitEdges(const std::vector<ThreadIndex> &threads) const;
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 多单位资源分配器（银行家算法）
+ *
+ * 管理若干种可计数的资源（连接槽位、内存预算、工作令牌等），避免“各拿一部分、互相等待”的死锁：
+ * - 客户端先声明对每种资源的最大需求
+ * - 申请只在分配后系统仍处于安全状态时批准，否则排队
+ * - 申请立即返回 future，批准时就绪，调用者不必阻塞
+ * - 提交新申请和释放资源后按提交顺序重新检查排队的申请，不安全的申请不会挡住后面安全的申请
+ *
+ * 安全性检查按资源维护“剩余需求”的有序集合，一次检查为 O(n·m)，
+ * 维护有序集合为 O(m·log n)，而不是朴素实现的 O(n²·m)（n 为客户端数，m 为资源种类数）。
+ */
+class ResourceManager
+{
+public:
+    using ClientId = uint32_t;
+    using Units = std::vector<unsigned>;
+
+    /**
+     * @param capacity 每种资源的总单位数
+     */
+    explicit ResourceManager(Units capacity);
+
+    /**
+     * @brief 注册客户端并声明最大需求
+     * @throws std::invalid_argument 如果种类数不符或某项超过总量
+     */
+    ClientId addClient(Units max_claim);
+
+    /**
+     * @brief 注销客户端，归还其全部资源，未批准的申请以 std::runtime_error 结束
+     */
+    void removeClient(ClientId client);
+
+    /**
+     * @brief 申请资源
+     * @return 批准时就绪的 future；安全时立即就绪
+     * @throws std::invalid_argument 如果客户端不存在，或已分配加本次申请超过声明的最大需求
+     */
+    std::future<void> request(ClientId client, const Units &units);
+
+    /**
+     * @brief 申请资源，不安全时立即返回 false 而不排队
+     */
+    bool tryRequest(ClientId client, const Units &units);
+
+    /**
+     * @brief 归还资源并批准因此变得安全的排队申请
+     * @throws std::invalid_argument 如果归还量超过已分配量
+     */
+    void release(ClientId client, const Units &units);
+
+    Units available() const;
+    Units allocation(ClientId client) const;
+    size_t pendingRequests() const;
+
+private:
+    struct Client
+    {
+        Units max_claim;
+        Units allocation;
+        bool active = true;
+    };
+
+    struct Pending
+    {
+        ClientId client;
+        Units units;
+        std::promise<void> promise;
+    };
+
+    const size_t kinds; // 资源种类数
+    mutable std::mutex mutex;
+    Units available_units;
+    std::vector<Client> clients;
+
+    // 每种资源按剩余需求（max - allocation）排序的活跃客户端
+    std::vector<std::multiset<std::pair<unsigned, ClientId>>> by_need;
+
+    std::deque<Pending> pending;
+
+    unsigned need(ClientId client, size_t kind) const;
+    void validate(ClientId client, const Units &units) const;
+    void adjust(ClientId client, const Units &units, bool grant);
+    bool isSafe() const;
+    bool tryGrant(ClientId client, const Units &units);
+    void grantPending(std::vector<std::promise<void>> &granted);
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include "resource_graph.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief 资源图中的事件节点：条件变量的通知或 future 的结果
+ *
+ * 事件没有互斥锁那样的“持有者”，这里把可能发出通知（或产生结果）的线程
+ * 登记为持有者，等待事件的线程登记为等待者，图中便有“等待者 -> 通知方”的边：
+ * - 通知方用 signaler() 返回的 SignalerScope 标明自己负责的区间
+ * - 等待方在阻塞期间登记等待
+ *
+ * 事件可以有多个通知方，只要其中一个还能运行就可能被唤醒，
+ * 因此涉及多通知方的报告是保守的，需要结合 blocked_by 判断。
+ */
+class TrackedEvent
+{
+private:
+    ResourceGraph *graph;           // 资源图引用
+    ResourceGraph::LockId event_id; // 在资源图中的编号
+
+public:
+    TrackedEvent(ResourceGraph *g, ResourceGraph::ResourceKind kind);
+    ~TrackedEvent();
+
+    TrackedEvent(const TrackedEvent &) = delete;
+    TrackedEvent &operator=(const TrackedEvent &) = delete;
+
+    /**
+     * @brief 当前线程在作用域内负责通知该事件（RAII）
+     */
+    class SignalerScope
+    {
+    private:
+        TrackedEvent *event;
+
+    public:
+        explicit SignalerScope(TrackedEvent *e);
+        ~SignalerScope();
+        SignalerScope(SignalerScope &&other) noexcept;
+        SignalerScope(const SignalerScope &) = delete;
+        SignalerScope &operator=(const SignalerScope &) = delete;
+        SignalerScope &operator=(SignalerScope &&) = delete;
+    };
+
+    SignalerScope signaler();
+
+    /**
+     * @brief 当前线程在作用域内等待该事件（RAII，异常时同样撤销）
+     */
+    class WaitScope
+    {
+    private:
+        TrackedEvent &event;
+
+    public:
+        explicit WaitScope(TrackedEvent &e) : event(e) { event.beginWaiting(); }
+        ~WaitScope() { event.endWaiting(); }
+        WaitScope(const WaitScope &) = delete;
+        WaitScope &operator=(const WaitScope &) = delete;
+    };
+
+    void beginSignaling();
+    void endSignaling();
+    void beginWaiting();
+    void endWaiting();
+};
+
+/**
+ * @brief 可追踪的条件变量
+ *
+ * 配合 TrackedMutex 使用时，等待期间释放的锁也会在资源图中同步释放。
+ * 通知方需要用 signaler() 登记，否则等待者没有出边，不会被计入环。
+ */
+class TrackedConditionVariable
+{
+private:
+    std::condition_variable_any cv;
+    TrackedEvent event;
+
+public:
+    explicit TrackedConditionVariable(ResourceGraph *g)
+        : event(g, ResourceGraph::ResourceKind::ConditionVariable) {}
+
+    TrackedEvent::SignalerScope signaler() { return event.signaler(); }
+
+    template <class Lock>
+    void wait(Lock &lock)
+    {
+        TrackedEvent::WaitScope scope(event);
+        cv.wait(lock);
+    }
+
+    template <class Lock, class Predicate>
+    void wait(Lock &lock, Predicate pred)
+    {
+        while (!pred())
+        {
+            wait(lock);
+        }
+    }
+
+    template <class Lock, class Rep, class Period, class Predicate>
+    bool wait_for(Lock &lock, const std::chrono::duration<Rep, Period> &timeout, Predicate pred)
+    {
+        TrackedEvent::WaitScope scope(event);
+        return cv.wait_for(lock, timeout, std::move(pred));
+    }
+
+    void notify_one() { cv.notify_one(); }
+    void notify_all() { cv.notify_all(); }
+};
+
+/**
+ * @brief 可追踪的 future 包装器
+ *
+ * 结果的生产方（例如线程池中执行任务的线程）通过共享的 TrackedEvent
+ * 登记为通知方，get()/wait() 阻塞期间登记等待，
+ * 于是“等结果的线程持有生产方需要的锁”会在图中形成环。
+ *
+ * @tparam Future std::future、std::shared_future 或任何提供 get()/wait() 的类型
+ */
+template <class Future>
+class TrackedFuture
+{
+private:
+    Future future;
+    std::shared_ptr<TrackedEvent> producer;
+
+public:
+    /**
+     * @param f 被包装的 future
+     * @param p 生产方登记的事件，生产方在产生结果前用 p->signaler() 标明自己
+     */
+    TrackedFuture(Future f, std::shared_ptr<TrackedEvent> p)
+        : future(std::move(f)), producer(std::move(p)) {}
+
+    /**
+     * @brief 创建生产方事件
+     */
+    static std::shared_ptr<TrackedEvent> makeProducer(ResourceGraph *graph)
+    {
+        return std::make_shared<TrackedEvent>(graph, ResourceGraph::ResourceKind::Future);
+    }
+
+    decltype(auto) get()
+    {
+        TrackedEvent::WaitScope scope(*producer);
+        return future.get();
+    }
+
+    void wait()
+    {
+        TrackedEvent::WaitScope scope(*producer);
+        future.wait();
+    }
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "resource_graph.hpp"
+#include "hold_budget.hpp"
+#include "lock_order.hpp"
 #include <mutex>
 
 /**
@@ -10,19 +12,39 @@
  * - 记录锁的实际获取
  * - 记录锁的释放
  * - 自动清理（RAII）
+ *
+ * 构造时向资源图注册一次锁编号，之后的追踪都使用编号，不再查找指针
  */
 class TrackedMutex
 {
 private:
-    std::mutex *mtx;      // 底层互斥锁
-    ResourceGraph *graph; // 资源图引用
-    bool locked = false;  // 锁定状态
+    std::mutex *mtx;                // 底层互斥锁
+    ResourceGraph *graph;           // 资源图引用
+    ResourceGraph::LockId lock_id;  // 在资源图中的编号
+    bool locked = false;            // 锁定状态
+    HoldBudget::Timer hold_timer;   // 持有时间预算，未设置时不计时
+    const LockOrder *lock_order = nullptr; // 绑定的顺序表，为空时不检查顺序
+    LockOrder::ClassId lock_class = 0;
 
 public:
     TrackedMutex(std::mutex *m, ResourceGraph *g);
     ~TrackedMutex();
 
+    TrackedMutex(const TrackedMutex &) = delete;
+    TrackedMutex &operator=(const TrackedMutex &) = delete;
+
     bool try_lock();
     void lock();
     void unlock();
-};
\ No newline at end of file
+
+    /**
+     * @brief 设置持有时间预算，应在未被持有时调用；传入空指针取消
+     */
+    void setHoldBudget(const HoldBudget *budget, const char *name = nullptr);
+
+    /**
+     * @brief 绑定到顺序表中的锁类，之后加锁前按顺序表检查；应在未被持有时调用
+     * @throws std::invalid_argument 如果锁类未声明
+     */
+    void bindClass(const LockOrder &order, const std::string &lock_class);
+};
@@ -0,0 +1,218 @@
+#pragma once
+#include "resource.hpp"
+#include "resource_graph.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 基于两阶段锁（2PL）的事务管理器
+ *
+ * 事务在扩张阶段逐个锁定 Resource，第一次释放后进入收缩阶段，不能再加锁：
+ * - 共享锁之间兼容，独占锁与任何锁冲突；持有共享锁时可申请升级为独占锁
+ * - 每个资源有 FIFO 等待队列，按到达顺序授予，后来的共享锁不会越过排队的独占锁
+ * - 死锁用时间戳预防，等待关系只会沿一个方向，不可能成环：
+ *   - WaitDie：较老的事务等待较年轻的，较年轻的直接中止
+ *   - WoundWait：较老的事务中止（wound）挡路的较年轻事务，较年轻的等待较老的
+ * - 被中止的事务抛出 Aborted；run() 释放全部锁，等挡路的事务结束后用原时间戳重试，
+ *   重试的事务越来越老，最终不会再被中止
+ *
+ * 传入 ResourceGraph 时，授予和等待以资源互斥锁的编号登记到图中，
+ * 与包装同一 Resource 互斥锁的 TrackedMutex 共用一个节点。
+ * 请求被授予后，等待线程醒来前图中仍显示其等待，共享锁的持有者之间可能短暂出现环；
+ * 持续存在的环才说明有问题。
+ */
+class TransactionManager
+{
+public:
+    enum class LockMode
+    {
+        Shared,
+        Exclusive
+    };
+
+    enum class Policy
+    {
+        WaitDie,
+        WoundWait
+    };
+
+    /**
+     * @brief 事务被中止，应释放全部锁后重试
+     */
+    class Aborted : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    struct Statistics
+    {
+        size_t committed = 0; // 提交的事务数
+        size_t aborted = 0;   // 中止的事务数（每次重试前的中止都计入）
+        size_t waits = 0;     // 加锁时需要等待的次数
+    };
+
+private:
+    struct TxnState;
+
+    struct Request
+    {
+        TxnState *txn;
+        LockMode mode;
+        bool granted;
+    };
+
+    struct LockState
+    {
+        std::list<Request> queue; // 已授予和等待的请求，等待的按到达顺序排列
+        ResourceGraph::LockId graph_id = 0;
+    };
+
+    struct TxnState : std::enable_shared_from_this<TxnState>
+    {
+        uint64_t timestamp;
+        bool aborted = false;
+        bool finished = false;
+        bool shrinking = false;
+        std::vector<Resource *> held;
+        std::condition_variable cv;
+
+        // 正在等待的请求，WoundWait 中止等待中的事务时从队列移除
+        Resource *waiting_on = nullptr;
+        std::list<Request>::iterator waiting_request;
+
+        // 导致本次中止的事务，重试前等它结束
+        std::shared_ptr<TxnState> killer;
+
+        explicit TxnState(uint64_t ts) : timestamp(ts) {}
+    };
+
+public:
+    /**
+     * @brief 一次事务尝试；析构时未提交则中止并释放全部锁
+     */
+    class Transaction
+    {
+    private:
+        TransactionManager *manager;
+        std::shared_ptr<TxnState> state;
+
+        friend class TransactionManager;
+        Transaction(TransactionManager *m, uint64_t timestamp);
+
+    public:
+        Transaction(Transaction &&other) noexcept = default;
+        Transaction(const Transaction &) = delete;
+        Transaction &operator=(const Transaction &) = delete;
+        Transaction &operator=(Transaction &&) = delete;
+        ~Transaction();
+
+        /**
+         * @brief 加锁，已持有足够强的锁时直接返回
+         * @throws Aborted 如果按死锁预防策略本事务被中止
+         * @throws std::logic_error 如果已进入收缩阶段或已结束
+         */
+        void lock(Resource &resource, LockMode mode);
+        void lockShared(Resource &resource) { lock(resource, LockMode::Shared); }
+        void lockExclusive(Resource &resource) { lock(resource, LockMode::Exclusive); }
+
+        /**
+         * @brief 释放一个资源并进入收缩阶段
+         * @throws std::logic_error 如果未持有该资源
+         */
+        void unlock(Resource &resource);
+
+        /**
+         * @brief 提交并释放全部锁
+         */
+        void commit();
+
+        /**
+         * @brief 中止并释放全部锁
+         */
+        void abort();
+
+        uint64_t timestamp() const { return state->timestamp; }
+        bool isShrinking() const;
+    };
+
+    explicit TransactionManager(Policy policy = Policy::WaitDie, ResourceGraph *graph = nullptr);
+
+    TransactionManager(const TransactionManager &) = delete;
+    TransactionManager &operator=(const TransactionManager &) = delete;
+
+    /**
+     * @brief 用新时间戳开始一个事务，中止后由调用者自行处理
+     */
+    Transaction begin();
+
+    /**
+     * @brief 执行事务体并提交，被中止时自动重试
+     *
+     * 所有重试使用同一时间戳；body 可能被执行多次，锁以外的副作用需要能重复执行。
+     *
+     * @param max_attempts 最多尝试次数，0 表示不限；用尽后抛出最后一次的 Aborted
+     */
+    template <class Body>
+    auto run(Body body, size_t max_attempts = 0) -> decltype(body(std::declval<Transaction &>()))
+    {
+        uint64_t timestamp = nextTimestamp();
+        for (size_t attempt = 1;; ++attempt)
+        {
+            Transaction txn(this, timestamp);
+            try
+            {
+                if constexpr (std::is_void_v<decltype(body(txn))>)
+                {
+                    body(txn);
+                    txn.commit();
+                    return;
+                }
+                else
+                {
+                    auto result = body(txn);
+                    txn.commit();
+                    return result;
+                }
+            }
+            catch (const Aborted &)
+            {
+                txn.abort();
+                if (max_attempts != 0 && attempt >= max_attempts)
+                {
+                    throw;
+                }
+                waitForKiller(*txn.state);
+            }
+        }
+    }
+
+    Statistics statistics() const;
+
+private:
+    const Policy policy;
+    ResourceGraph *graph;
+
+    mutable std::mutex mutex;
+    std::condition_variable finished_cv; // 任一事务结束时通知，供重试等待
+    std::unordered_map<Resource *, LockState> table;
+    uint64_t next_timestamp = 1;
+    Statistics stats;
+
+    uint64_t nextTimestamp();
+    void acquire(const std::shared_ptr<TxnState> &txn, Resource &resource, LockMode mode);
+    void release(TxnState &txn, Resource &resource);
+    void finish(TxnState &txn, bool committed);
+    void grant(LockState &state);
+    void wound(TxnState &victim, const std::shared_ptr<TxnState> &by);
+    void dropIfIdle(Resource *resource);
+    void waitForKiller(TxnState &txn);
+};
@@ -1,37 +1,139 @@
 #include "hierarchical_mutex.hpp"
+#include <string>
+
+thread_local HierarchicalMutex::HeldStack HierarchicalMutex::held;
 
 HierarchicalMutex::HierarchicalMutex(unsigned long level)
     : hierarchy_level(level) {}
 
-void HierarchicalMutex::lock()
+HierarchicalMutex::HierarchicalMutex(const LockOrder &order, const std::string &name)
+    : hierarchy_level(order.level(order.classId(name))), lock_order(&order), lock_class(order.classId(name)) {}
+
+/**
+ * @brief 当前线程持有的最低层级，未持有时为 ULONG_MAX
+ */
+unsigned long HierarchicalMutex::currentLevel()
+{
+    return held.size == 0 ? ULONG_MAX : held.entries[held.size - 1].level;
+}
+
+void HierarchicalMutex::push(const char *file, int line)
+{
+    held.entries[held.size++] = HeldLock{this, hierarchy_level, file, line};
+}
+
+void HierarchicalMutex::lock(const char *file, int line)
 {
-    // 检查是否违反层级约束
-    if (previous_hierarchy_level <= hierarchy_level)
+    if (held.size == max_held)
+    {
+        throw std::runtime_error("Too many hierarchical mutexes held");
+    }
+    // 检查是否违反层级约束，绑定了锁类时改由顺序表检查
+    if (lock_order != nullptr)
+    {
+        lock_order->beforeAcquire(this, lock_class);
+    }
+    else if (currentLevel() <= hierarchy_level)
     {
         throw std::runtime_error("Mutex hierarchy violated");
     }
     mutex.lock();
-    // 更新前一个层级
-    previous_hierarchy_level = hierarchy_level;
+    push(file, line);
+    hold_timer.acquired();
 }
 
 void HierarchicalMutex::unlock()
 {
-    // 恢复前一个层级
-    previous_hierarchy_level = hierarchy_level;
+    // 从栈中移除该锁，后面的记录前移，层级仍保持递减
+    for (size_t i = held.size; i-- > 0;)
+    {
+        if (held.entries[i].mutex == this)
+        {
+            for (size_t j = i + 1; j < held.size; ++j)
+            {
+                held.entries[j - 1] = held.entries[j];
+            }
+            held.size--;
+            break;
+        }
+    }
+    if (lock_order != nullptr)
+    {
+        lock_order->release(this);
+    }
+    HoldBudget::Violation violation;
+    const HoldBudget *exceeded = hold_timer.released(this, violation);
     mutex.unlock();
+    // 回调在锁外执行
+    if (exceeded)
+    {
+        exceeded->report(violation);
+    }
 }
 
-bool HierarchicalMutex::try_lock()
+void HierarchicalMutex::setHoldBudget(const HoldBudget *budget, const char *name)
 {
-    if (previous_hierarchy_level <= hierarchy_level)
+    hold_timer.assign(budget, name);
+}
+
+bool HierarchicalMutex::try_lock(const char *file, int line)
+{
+    if (held.size == max_held)
+    {
+        return false;
+    }
+    if (lock_order != nullptr)
+    {
+        if (!lock_order->tryBeforeAcquire(this, lock_class))
+        {
+            return false;
+        }
+    }
+    else if (currentLevel() <= hierarchy_level)
     {
         return false;
     }
     if (mutex.try_lock())
     {
-        previous_hierarchy_level = hierarchy_level;
+        push(file, line);
+        hold_timer.acquired();
         return true;
     }
+    if (lock_order != nullptr)
+    {
+        lock_order->acquireFailed(this);
+    }
+    return false;
+}
+
+bool HierarchicalMutex::isHeldByCurrentThread() const
+{
+    for (size_t i = 0; i < held.size; ++i)
+    {
+        if (held.entries[i].mutex == this)
+        {
+            return true;
+        }
+    }
     return false;
-}
\ No newline at end of file
+}
+
+std::vector<HierarchicalMutex::HeldLock> HierarchicalMutex::heldLocks()
+{
+    return std::vector<HeldLock>(held.entries, held.entries + held.size);
+}
+
+void HierarchicalMutex::assertNoLocksHeld(const char *where)
+{
+    if (held.size == 0)
+    {
+        return;
+    }
+    std::string message = std::string("Hierarchical mutex held across blocking point ") + where + ":";
+    for (size_t i = 0; i < held.size; ++i)
+    {
+        const HeldLock &entry = held.entries[i];
+        message += " level " + std::to_string(entry.level) + " at " + entry.file + ":" + std::to_string(entry.line);
+    }
+    throw std::logic_error(message);
+}
@@ -0,0 +1,25 @@
+#include "hold_budget.hpp"
+
+HoldBudget::HoldBudget(std::chrono::nanoseconds b, Callback cb, unsigned period)
+    : budget(b), callback(std::move(cb)), sample_period(period > 0 ? period : 1) {}
+
+void HoldBudget::Timer::assign(const HoldBudget *b, const char *n)
+{
+    budget = b;
+    name = n;
+    acquisitions = 0;
+    timing = false;
+}
+
+const HoldBudget *HoldBudget::Timer::finish(const void *lock, Violation &violation)
+{
+    timing = false;
+    auto held = std::chrono::steady_clock::now() - start;
+    if (held <= budget->budget)
+    {
+        return nullptr;
+    }
+    violation = Violation{lock, name, std::this_thread::get_id(),
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(held), budget->budget};
+    return budget;
+}
@@ -0,0 +1,238 @@
+#include "lock_order.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+thread_local LockOrder::HeldStack LockOrder::held;
+
+namespace
+{
+    std::string trim(const std::string &text)
+    {
+        size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+}
+
+LockOrder::LockOrder(Mode mode)
+    : current_mode(mode), log([](const std::string &message)
+                              { std::cerr << message << std::endl; }) {}
+
+LockOrder::LockOrder(const std::vector<Rule> &rules, Mode mode) : LockOrder(mode)
+{
+    std::vector<std::pair<ClassId, ClassId>> edges;
+    for (const Rule &rule : rules)
+    {
+        ClassId before = intern(rule.before);
+        edges.emplace_back(before, intern(rule.after));
+    }
+    build(edges);
+}
+
+std::unique_ptr<LockOrder> LockOrder::parse(std::istream &in, Mode mode)
+{
+    std::unique_ptr<LockOrder> order(new LockOrder(mode));
+    std::vector<std::pair<ClassId, ClassId>> edges;
+    std::string line;
+    for (size_t number = 1; std::getline(in, line); ++number)
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        // 按 “->” 切分成一条链
+        std::vector<ClassId> chain;
+        size_t begin = 0;
+        while (true)
+        {
+            size_t arrow = line.find("->", begin);
+            std::string name = trim(line.substr(begin, arrow == std::string::npos ? std::string::npos : arrow - begin));
+            if (name.empty() || name.find_first_of(" \t") != std::string::npos)
+            {
+                throw std::invalid_argument("LockOrder: bad lock class name on line " + std::to_string(number));
+            }
+            chain.push_back(order->intern(name));
+            if (arrow == std::string::npos)
+            {
+                break;
+            }
+            begin = arrow + 2;
+        }
+        for (size_t i = 0; i + 1 < chain.size(); ++i)
+        {
+            edges.emplace_back(chain[i], chain[i + 1]);
+        }
+    }
+    order->build(edges);
+    return order;
+}
+
+std::unique_ptr<LockOrder> LockOrder::load(const std::string &path, Mode mode)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error("LockOrder: cannot open " + path);
+    }
+    return parse(in, mode);
+}
+
+LockOrder::ClassId LockOrder::classId(const std::string &name) const
+{
+    auto found = ids.find(name);
+    if (found == ids.end())
+    {
+        throw std::invalid_argument("LockOrder: unknown lock class " + name);
+    }
+    return found->second;
+}
+
+void LockOrder::setLogger(std::function<void(const std::string &)> logger)
+{
+    log = std::move(logger);
+}
+
+LockOrder::ClassId LockOrder::intern(const std::string &name)
+{
+    auto found = ids.find(name);
+    if (found != ids.end())
+    {
+        return found->second;
+    }
+    ClassId id = static_cast<ClassId>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+/**
+ * @brief 拓扑排序检查环，再按逆拓扑序求传递闭包和层级
+ *
+ * 每条边把后继的可达集合并入一次，O(E·n/64)；200 个锁类只需几微秒。
+ */
+void LockOrder::build(const std::vector<std::pair<ClassId, ClassId>> &edges)
+{
+    size_t n = names.size();
+    std::vector<std::vector<ClassId>> successors(n);
+    std::vector<size_t> indegree(n, 0);
+    for (const auto &edge : edges)
+    {
+        successors[edge.first].push_back(edge.second);
+        indegree[edge.second]++;
+    }
+
+    std::vector<ClassId> order;
+    for (ClassId id = 0; id < n; ++id)
+    {
+        if (indegree[id] == 0)
+        {
+            order.push_back(id);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        for (ClassId next : successors[order[i]])
+        {
+            if (--indegree[next] == 0)
+            {
+                order.push_back(next);
+            }
+        }
+    }
+    if (order.size() != n)
+    {
+        for (ClassId id = 0; id < n; ++id)
+        {
+            if (indegree[id] != 0)
+            {
+                throw std::invalid_argument("LockOrder: cyclic order involving lock class " + names[id]);
+            }
+        }
+    }
+
+    reach.assign(n, DenseBitset());
+    levels.assign(n, 1);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        ClassId id = *it;
+        for (ClassId next : successors[id])
+        {
+            reach[id].set(next);
+            reach[id] |= reach[next];
+            levels[id] = std::max(levels[id], levels[next] + 1);
+        }
+    }
+}
+
+void LockOrder::beforeAcquire(const void *lock, ClassId id) const
+{
+    record(lock, id, true);
+}
+
+bool LockOrder::tryBeforeAcquire(const void *lock, ClassId id) const
+{
+    return record(lock, id, false);
+}
+
+bool LockOrder::record(const void *lock, ClassId id, bool throw_on_violation) const
+{
+    // 和每个持有的同表锁比较：LogOnly 下违规的锁也会入栈，持有的锁不一定两两有序
+    Mode current = mode();
+    if (current != Mode::Off)
+    {
+        for (size_t i = held.size; i-- > 0;)
+        {
+            if (held.entries[i].order != this || allowed(held.entries[i].id, id))
+            {
+                continue;
+            }
+            std::string message = "Lock order violated: acquiring " + names[id] + " while holding " +
+                                  names[held.entries[i].id];
+            if (current == Mode::Fail)
+            {
+                if (throw_on_violation)
+                {
+                    throw std::runtime_error(message);
+                }
+                return false;
+            }
+            log(message);
+            break;
+        }
+    }
+
+    if (held.size == max_held)
+    {
+        if (throw_on_violation)
+        {
+            throw std::runtime_error("Too many ordered locks held");
+        }
+        return false;
+    }
+    held.entries[held.size++] = HeldClass{this, lock, id};
+    return true;
+}
+
+void LockOrder::release(const void *lock) const
+{
+    for (size_t i = held.size; i-- > 0;)
+    {
+        if (held.entries[i].lock == lock)
+        {
+            for (size_t j = i + 1; j < held.size; ++j)
+            {
+                held.entries[j - 1] = held.entries[j];
+            }
+            held.size--;
+            return;
+        }
+    }
+}
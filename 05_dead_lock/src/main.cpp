@@ -6,6 +6,7 @@
 #include "tracked_mutex.hpp"
 #include "hierarchical_mutex.hpp"
 #include "resource.hpp"
+#include "lock_order.hpp"
 
 // 模拟可能导致死锁的场景
 void simulateDeadlockScenario(ResourceGraph &graph)
@@ -60,8 +61,17 @@ void simulateDeadlockScenario(ResourceGraph &graph)
                          {
         while (true) {
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            if (graph.hasDeadlock()) {
+            auto deadlocks = graph.findDeadlocks();
+            if (!deadlocks.empty()) {
                 std::cout << "Deadlock detected!" << std::endl;
+                for (const auto &deadlock : deadlocks) {
+                    for (const auto &thread : deadlock.threads) {
+                        std::cout << "  thread " << thread.id << " holds " << thread.held.size()
+                                  << " lock(s), waiting "
+                                  << std::chrono::duration_cast<std::chrono::milliseconds>(thread.waited).count()
+                                  << "ms" << std::endl;
+                    }
+                }
                 break;
             }
         } });
@@ -129,11 +139,38 @@ void demonstrateDeadlockPrevention()
             m2.unlock();
         }
     }
+
+    // 4. 使用声明式的加锁顺序表
+    {
+        std::cout << "4. Using a lock-order table:\n";
+        static constexpr LockOrder::Rule rules[] = {{"config", "cache"}, {"cache", "db"}};
+        LockOrder order(rules);
+        HierarchicalMutex cache(order, "cache");
+        HierarchicalMutex db(order, "db");
+
+        {
+            std::scoped_lock lock(cache);
+            std::scoped_lock inner(db); // 正确：cache 在 db 之前
+            std::cout << "   Acquired cache then db\n";
+        }
+
+        try
+        {
+            std::scoped_lock lock(db);
+            std::scoped_lock inner(cache); // 错误：违反顺序表
+        }
+        catch (const std::runtime_error &e)
+        {
+            std::cout << "   Expected error: " << e.what() << std::endl;
+        }
+    }
 }
 
 int main()
 {
     ResourceGraph graph;
+    // 进程卡住时执行 kill -USR2 <pid>，在标准错误输出当前的持有和等待关系
+    graph.enableSignalDump();
 
     // std::cout << "Simulating potential deadlock scenario...\n";
     // simulateDeadlockScenario(graph);
@@ -1,133 +1,516 @@
 #include "resource_graph.hpp"
+#include <algorithm>
+
+namespace
+{
+    // 线程编号分配器，只在线程首次使用资源图和退出时加锁
+    std::mutex thread_index_mutex;
+    std::vector<ResourceGraph::ThreadIndex> free_thread_indices;
+    ResourceGraph::ThreadIndex next_thread_index = 0;
+    uint64_t next_thread_generation = 0;
+
+    /**
+     * @brief 持有当前线程的编号，线程退出时归还
+     */
+    struct ThreadIndexSlot
+    {
+        ResourceGraph::ThreadIndex value;
+        uint64_t generation; // 每次分配都不同，资源图据此发现编号已换了主人
+
+        ThreadIndexSlot()
+        {
+            std::lock_guard<std::mutex> lock(thread_index_mutex);
+            generation = ++next_thread_generation;
+            if (free_thread_indices.empty())
+            {
+                value = next_thread_index++;
+            }
+            else
+            {
+                // 复用最小的编号，使位集保持紧凑
+                auto smallest = free_thread_indices.begin();
+                for (auto it = free_thread_indices.begin(); it != free_thread_indices.end(); ++it)
+                {
+                    if (*it < *smallest)
+                    {
+                        smallest = it;
+                    }
+                }
+                value = *smallest;
+                free_thread_indices.erase(smallest);
+            }
+        }
+
+        ~ThreadIndexSlot()
+        {
+            std::lock_guard<std::mutex> lock(thread_index_mutex);
+            free_thread_indices.push_back(value);
+        }
+    };
+
+    thread_local ThreadIndexSlot thread_index;
+}
+
+ResourceGraph::ResourceGraph(size_t max_threads)
+    : max_slots(max_threads), slots(new ThreadSlot[max_threads]) {}
+
+ResourceGraph::~ResourceGraph()
+{
+    disableSignalDump();
+}
+
+ResourceGraph::ThreadIndex ResourceGraph::currentThread()
+{
+    return thread_index.value;
+}
+
+/**
+ * @brief 为互斥锁分配编号，TrackedMutex 构造时调用一次
+ * @param mtx 互斥锁指针
+ * @return 锁编号，此后的获取、释放、等待都使用该编号
+ */
+ResourceGraph::LockId ResourceGraph::registerLock(std::mutex *mtx)
+{
+    return registerResource(mtx, ResourceKind::Mutex);
+}
+
+/**
+ * @brief 为条件变量、future 等对象分配资源编号
+ * @param object 对象地址，同一地址总是得到同一编号
+ * @param kind 资源类型，用于报告
+ */
+ResourceGraph::LockId ResourceGraph::registerResource(const void *object, ResourceKind kind)
+{
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    LockId id = lockIdFor(object, kind);
+    lock_refs[id]++;
+    return id;
+}
+
+/**
+ * @brief 释放一个引用，最后一个引用释放后回收编号
+ * @param id 锁编号
+ */
+void ResourceGraph::unregisterLock(LockId id)
+{
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    if (--lock_refs[id] != 0)
+    {
+        return;
+    }
+
+    lock_ids.erase(lock_resources[id].object);
+    lock_resources[id].object = nullptr;
+
+    // 清除各线程行中的这一列，否则编号被复用后新锁会继承旧的持有和等待
+    lock_holders[id].clear();
+    for (ThreadIndex thread = 0; thread < thread_holds.size(); ++thread)
+    {
+        if (thread_holds[thread].test(id))
+        {
+            thread_holds[thread].reset(id);
+            publishRemove(thread, false, id);
+        }
+        if (thread_waits[thread].test(id))
+        {
+            thread_waits[thread].reset(id);
+            publishRemove(thread, true, id);
+            if (!thread_waits[thread].any())
+            {
+                waiting_threads.reset(thread);
+            }
+        }
+    }
+    free_lock_ids.push_back(id);
+}
+
+/**
+ * @brief 查找或分配锁编号，调用者需持有 graph_mutex
+ */
+ResourceGraph::LockId ResourceGraph::lockIdFor(const void *object, ResourceKind kind)
+{
+    auto it = lock_ids.find(object);
+    if (it != lock_ids.end())
+    {
+        return it->second;
+    }
+
+    LockId id;
+    if (free_lock_ids.empty())
+    {
+        id = static_cast<LockId>(lock_resources.size());
+        lock_resources.push_back(ResourceRef{object, kind});
+        lock_refs.push_back(0);
+        lock_holders.emplace_back();
+    }
+    else
+    {
+        id = free_lock_ids.back();
+        free_lock_ids.pop_back();
+        lock_resources[id] = ResourceRef{object, kind};
+    }
+    lock_ids.emplace(object, id);
+    return id;
+}
+
+/**
+ * @brief 确保当前线程的行已分配，调用者需持有 graph_mutex
+ *
+ * 编号在线程退出后会被新线程复用；新线程第一次使用资源图时清除旧线程留下的持有和等待。
+ */
+void ResourceGraph::ensureThread(ThreadIndex thread)
+{
+    if (thread >= thread_holds.size())
+    {
+        thread_holds.resize(thread + 1);
+        thread_waits.resize(thread + 1);
+        thread_ids.resize(thread + 1);
+        thread_generations.resize(thread + 1, 0);
+        wait_started.resize(thread + 1);
+    }
+    if (thread_generations[thread] == thread_index.generation)
+    {
+        return;
+    }
+
+    thread_holds[thread].forEach([this, thread](size_t id)
+                                 {
+        lock_holders[id].reset(thread);
+        publishRemove(thread, false, static_cast<LockId>(id)); });
+    thread_waits[thread].forEach([this, thread](size_t id)
+                                 { publishRemove(thread, true, static_cast<LockId>(id)); });
+    thread_holds[thread].clear();
+    thread_waits[thread].clear();
+    waiting_threads.reset(thread);
+    thread_generations[thread] = thread_index.generation;
+    thread_ids[thread] = std::this_thread::get_id();
+}
 
 /**
  * @brief 记录线程获取到的锁
- * @param mtx 被线程获取的互斥锁指针
+ * @param id 被线程获取的锁编号
  */
-void ResourceGraph::acquireLock(std::mutex *mtx)
+void ResourceGraph::acquireLock(LockId id)
 {
+    ThreadIndex thread = currentThread();
     // 保护资源图的互斥锁
     std::lock_guard<std::mutex> lock(graph_mutex);
-    // 记录当前线程持有的锁
-    thread_holds[std::this_thread::get_id()].insert(mtx);
+    ensureThread(thread);
+    // 获取到锁即不再等待它；调用者可以不先调用 stopWaiting
+    if (thread_waits[thread].test(id))
+    {
+        thread_waits[thread].reset(id);
+        publishRemove(thread, true, id);
+        if (!thread_waits[thread].any())
+        {
+            waiting_threads.reset(thread);
+        }
+    }
+    // 记录当前线程持有的锁，重复登记时保留最初的获取时间
+    if (!thread_holds[thread].test(id))
+    {
+        thread_holds[thread].set(id);
+        lock_holders[id].set(thread);
+        publishAdd(thread, false, id);
+    }
 }
 
 /**
  * @brief 记录线程释放的锁
- * @param mtx 被释放的互斥锁指针
+ * @param id 被释放的锁编号
  */
-void ResourceGraph::releaseLock(std::mutex *mtx)
+void ResourceGraph::releaseLock(LockId id)
 {
+    ThreadIndex thread = currentThread();
     std::lock_guard<std::mutex> lock(graph_mutex);
-    // 从当前线程持有的锁集合中移除
-    thread_holds[std::this_thread::get_id()].erase(mtx);
-
-    // 如果线程不再持有任何锁，清理该记录
-    if (thread_holds[std::this_thread::get_id()].empty())
+    ensureThread(thread);
+    if (thread_holds[thread].test(id))
     {
-        thread_holds.erase(std::this_thread::get_id());
+        thread_holds[thread].reset(id);
+        lock_holders[id].reset(thread);
+        publishRemove(thread, false, id);
     }
 }
 
 /**
  * @brief 记录线程正在等待的锁
- * @param mtx 正在等待的互斥锁指针
+ * @param id 正在等待的锁编号
  */
-void ResourceGraph::waitForLock(std::mutex *mtx)
+void ResourceGraph::waitForLock(LockId id)
 {
+    ThreadIndex thread = currentThread();
     std::lock_guard<std::mutex> lock(graph_mutex);
-    // 记录当前线程正在等待的锁
-    thread_waits[std::this_thread::get_id()].insert(mtx);
+    ensureThread(thread);
+    if (!waiting_threads.test(thread))
+    {
+        wait_started[thread] = std::chrono::steady_clock::now();
+    }
+    if (!thread_waits[thread].test(id))
+    {
+        thread_waits[thread].set(id);
+        waiting_threads.set(thread);
+        publishAdd(thread, true, id);
+    }
 }
 
 /**
  * @brief 记录线程停止等待某个锁（可能是获取到了或者放弃等待）
- * @param mtx 停止等待的互斥锁指针
+ * @param id 停止等待的锁编号
  */
-void ResourceGraph::stopWaiting(std::mutex *mtx)
+void ResourceGraph::stopWaiting(LockId id)
 {
+    ThreadIndex thread = currentThread();
     std::lock_guard<std::mutex> lock(graph_mutex);
-    // 从当前线程等待的锁集合中移除
-    thread_waits[std::this_thread::get_id()].erase(mtx);
+    ensureThread(thread);
+    if (thread_waits[thread].test(id))
+    {
+        thread_waits[thread].reset(id);
+        publishRemove(thread, true, id);
+    }
+
+    // 如果线程不再等待任何锁，不再参与环检测
+    if (!thread_waits[thread].any())
+    {
+        waiting_threads.reset(thread);
+    }
+}
+
+void ResourceGraph::acquireLock(std::mutex *mtx)
+{
+    LockId id;
+    {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        id = pinnedLockId(mtx);
+    }
+    acquireLock(id);
+}
+
+void ResourceGraph::releaseLock(std::mutex *mtx)
+{
+    LockId id;
+    {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        id = pinnedLockId(mtx);
+    }
+    releaseLock(id);
+}
+
+void ResourceGraph::waitForLock(std::mutex *mtx)
+{
+    LockId id;
+    {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        id = pinnedLockId(mtx);
+    }
+    waitForLock(id);
+}
+
+void ResourceGraph::stopWaiting(std::mutex *mtx)
+{
+    LockId id;
+    {
+        std::lock_guard<std::mutex> lock(graph_mutex);
+        id = pinnedLockId(mtx);
+    }
+    stopWaiting(id);
+}
+
+/**
+ * @brief 查找或分配锁编号，首次分配时额外保留一个引用，使编号不被回收
+ *
+ * 调用者需持有 graph_mutex
+ */
+ResourceGraph::LockId ResourceGraph::pinnedLockId(std::mutex *mtx)
+{
+    bool known = lock_ids.count(mtx) != 0;
+    LockId id = lockIdFor(mtx, ResourceKind::Mutex);
+    if (!known)
+    {
+        lock_refs[id]++;
+    }
+    return id;
+}
 
-    // 如果线程不再等待任何锁，清理该记录
-    if (thread_waits[std::this_thread::get_id()].empty())
+/**
+ * @brief 计算各线程在等待图中的出边，调用者需持有 graph_mutex
+ * @param threads 正在等待的线程
+ * @return edges[i] 为 threads[i] 所等待的锁的持有线程位集
+ */
+std::vector<DenseBitset> ResourceGraph::waitEdges(const std::vector<ThreadIndex> &threads) const
+{
+    std::vector<DenseBitset> edges(threads.size());
+    for (size_t i = 0; i < threads.size(); ++i)
     {
-        thread_waits.erase(std::this_thread::get_id());
+        // 保留自环：等待自己持有的锁（如重复锁定非递归互斥锁）本身就是死锁
+        thread_waits[threads[i]].forEach([this, &edges, i](size_t id)
+                                         { edges[i] |= lock_holders[id]; });
     }
+    return edges;
 }
 
 /**
  * @brief 检查系统中是否存在死锁
+ *
+ * 等待图的边 A -> B 表示 A 等待的某个锁由 B 持有，A 的出边集合即
+ * A 等待的各个锁的持有线程位集之并。反复剔除没有出边指向剩余节点的线程，
+ * 最后仍有剩余则说明存在环。全部是按字进行的位运算，没有递归。
+ *
  * @return 如果检测到死锁返回true，否则返回false
  */
 bool ResourceGraph::hasDeadlock()
 {
     std::lock_guard<std::mutex> lock(graph_mutex);
-    std::set<std::thread::id> visited;         // 记录已访问的线程
-    std::set<std::thread::id> recursion_stack; // 当前递归栈中的线程
 
-    // 对每个持有锁的线程进行深度优先搜索
-    for (const auto &[thread_id, _] : thread_holds)
+    // 只有正在等待的线程才有出边
+    std::vector<ThreadIndex> candidates;
+    waiting_threads.forEach([&candidates](size_t thread)
+                            { candidates.push_back(static_cast<ThreadIndex>(thread)); });
+    std::vector<DenseBitset> edges = waitEdges(candidates);
+
+    DenseBitset alive = waiting_threads;
+    bool changed = true;
+    while (changed)
     {
-        // 如果这个线程还未被访问过
-        if (visited.find(thread_id) == visited.end())
+        changed = false;
+        for (size_t i = 0; i < candidates.size(); ++i)
         {
-            // 从这个线程开始进行深度优先搜索，检查是否存在环
-            if (hasCycle(thread_id, visited, recursion_stack))
+            if (alive.test(candidates[i]) && !edges[i].intersects(alive))
             {
-                return true; // 发现环，表示存在死锁
+                alive.reset(candidates[i]);
+                changed = true;
             }
         }
     }
-    return false; // 没有发现环，不存在死锁
+    return alive.any(); // 剩余的线程都在环上或在通往环的路径上
 }
 
-/**
- * @brief 使用深度优先搜索检测等待图中是否存在环
- * @param current 当前正在检查的线程ID
- * @param visited 记录所有已访问的线程
- * @param recursion_stack 当前递归栈中的线程
- * @return 如果检测到环返回true，否则返回false
- */
-bool ResourceGraph::hasCycle(std::thread::id current,
-                             std::set<std::thread::id> &visited,
-                             std::set<std::thread::id> &recursion_stack)
+std::vector<ResourceGraph::Deadlock> ResourceGraph::findDeadlocks()
 {
-    visited.insert(current);         // 标记当前线程为已访问
-    recursion_stack.insert(current); // 将当前线程加入递归栈
+    std::lock_guard<std::mutex> lock(graph_mutex);
+    auto now = std::chrono::steady_clock::now();
 
-    // 获取当前线程正在等待的所有锁
-    const auto &waiting_locks = thread_waits[current];
+    std::vector<ThreadIndex> nodes;
+    waiting_threads.forEach([&nodes](size_t thread)
+                            { nodes.push_back(static_cast<ThreadIndex>(thread)); });
+    std::vector<DenseBitset> edges = waitEdges(nodes);
 
-    // 对于当前线程等待的每个锁
-    for (const auto &lock : waiting_locks)
+    // 只保留指向其它等待线程的边：不在等待的线程没有出边，不可能位于环上
+    std::vector<int> local(thread_holds.size(), -1);
+    for (size_t i = 0; i < nodes.size(); ++i)
     {
-        // 查找持有这个锁的所有线程
-        for (const auto &[thread_id, held_locks] : thread_holds)
+        local[nodes[i]] = static_cast<int>(i);
+    }
+    std::vector<std::vector<int>> successors(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        edges[i].forEach([&](size_t thread)
+                         {
+            if (thread < local.size() && local[thread] >= 0)
+            {
+                successors[i].push_back(local[thread]);
+            } });
+    }
+
+    // 迭代 Tarjan：frames 模拟递归调用栈，每帧记录节点和下一条待访问的边
+    const int unvisited = -1;
+    std::vector<int> order(nodes.size(), unvisited);
+    std::vector<int> low(nodes.size(), 0);
+    std::vector<bool> on_stack(nodes.size(), false);
+    std::vector<int> stack;
+    std::vector<std::pair<int, size_t>> frames;
+    std::vector<std::vector<int>> components;
+    int counter = 0;
+
+    for (size_t root = 0; root < nodes.size(); ++root)
+    {
+        if (order[root] != unvisited)
+        {
+            continue;
+        }
+        frames.emplace_back(static_cast<int>(root), 0);
+        while (!frames.empty())
         {
-            // 如果找到了持有这个锁的线程
-            if (held_locks.find(lock) != held_locks.end())
+            auto &[v, next] = frames.back();
+            if (next == 0 && order[v] == unvisited)
+            {
+                order[v] = low[v] = counter++;
+                stack.push_back(v);
+                on_stack[v] = true;
+            }
+
+            if (next < successors[v].size())
             {
-                // 如果这个线程还未被访问过
-                if (visited.find(thread_id) == visited.end())
+                int w = successors[v][next++];
+                if (order[w] == unvisited)
                 {
-                    // 继续深度优先搜索
-                    if (hasCycle(thread_id, visited, recursion_stack))
-                    {
-                        return true; // 发现环
-                    }
+                    frames.emplace_back(w, 0); // v 的引用此后失效
                 }
-                // 如果这个线程已经在递归栈中，说明形成了环
-                else if (recursion_stack.find(thread_id) != recursion_stack.end())
+                else if (on_stack[w])
                 {
-                    return true;
+                    low[v] = std::min(low[v], order[w]);
+                }
+                continue;
+            }
+
+            // v 的边已全部访问，相当于递归返回
+            int finished = v;
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                int parent = frames.back().first;
+                low[parent] = std::min(low[parent], low[finished]);
+            }
+            if (low[finished] == order[finished])
+            {
+                std::vector<int> component;
+                int w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = false;
+                    component.push_back(w);
+                } while (w != finished);
+
+                // 单个节点的分量只有带自环时才构成死锁
+                if (component.size() > 1 || edges[finished].test(nodes[finished]))
+                {
+                    components.push_back(std::move(component));
                 }
             }
         }
     }
 
-    // 回溯时将当前线程从递归栈中移除
-    recursion_stack.erase(current);
-    return false;
-}
\ No newline at end of file
+    std::vector<Deadlock> deadlocks;
+    for (const auto &component : components)
+    {
+        DenseBitset members;
+        for (int v : component)
+        {
+            members.set(nodes[v]);
+        }
+
+        Deadlock deadlock;
+        for (auto it = component.rbegin(); it != component.rend(); ++it)
+        {
+            ThreadIndex thread = nodes[*it];
+            DeadlockedThread info;
+            info.index = thread;
+            info.id = thread_ids[thread];
+            info.waited = now - wait_started[thread];
+            thread_holds[thread].forEach([this, &info](size_t id)
+                                         { info.held.push_back(lock_resources[id]); });
+            thread_waits[thread].forEach([this, &info](size_t id)
+                                         { info.waiting_for.push_back(lock_resources[id]); });
+            edges[*it].forEach([&members, &info](size_t other)
+                               {
+                if (members.test(other))
+                {
+                    info.blocked_by.push_back(static_cast<ThreadIndex>(other));
+                } });
+            deadlock.threads.push_back(std::move(info));
+        }
+        deadlocks.push_back(std::move(deadlock));
+    }
+    return deadlocks;
+}
@@ -0,0 +1,390 @@
+#include "resource_graph.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    // 启用了信号导出的资源图，信号处理函数通过它找到管道
+    std::atomic<int> dump_pipe_write{-1};
+    std::atomic<bool> dump_enabled{false};
+    // 正在执行的信号处理函数个数，关闭写端前等它归零
+    std::atomic<int> dump_handlers_running{0};
+
+    int64_t now_ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void on_dump_signal(int)
+    {
+        // 只调用异步信号安全的 write
+        int saved_errno = errno;
+        // 先登记再读 fd：disableSignalDump 清空 fd 之后才登记的处理函数一定读到 -1
+        dump_handlers_running.fetch_add(1);
+        int fd = dump_pipe_write.load();
+        if (fd >= 0)
+        {
+            char byte = 'd';
+            ssize_t written = ::write(fd, &byte, 1);
+            (void)written;
+        }
+        dump_handlers_running.fetch_sub(1);
+        errno = saved_errno;
+    }
+
+    const char *kind_name(ResourceGraph::ResourceKind kind)
+    {
+        switch (kind)
+        {
+        case ResourceGraph::ResourceKind::Mutex:
+            return "mutex";
+        case ResourceGraph::ResourceKind::ConditionVariable:
+            return "condition_variable";
+        case ResourceGraph::ResourceKind::Future:
+            return "future";
+        }
+        return "unknown";
+    }
+
+    double to_ms(std::chrono::steady_clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    }
+
+    void write_all(int fd, const std::string &text)
+    {
+        size_t offset = 0;
+        while (offset < text.size())
+        {
+            ssize_t n = ::write(fd, text.data() + offset, text.size() - offset);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return;
+            }
+            offset += static_cast<size_t>(n);
+        }
+    }
+}
+
+/**
+ * @brief 在槽位中追加一条记录，调用者为槽位所属线程且持有 graph_mutex
+ */
+void ResourceGraph::publishAdd(ThreadIndex thread, bool wait, LockId id)
+{
+    if (thread >= max_slots)
+    {
+        slots_overflow = true;
+        return;
+    }
+
+    ThreadSlot &slot = slots[thread];
+    auto &count = wait ? slot.wait_count : slot.held_count;
+    SlotEntry *entries = wait ? slot.waits : slot.held;
+    size_t capacity = wait ? ThreadSlot::max_waits : ThreadSlot::max_held;
+
+    uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // 编号可能被新线程复用，每次写入时刷新
+    slot.os_id.store(static_cast<long>(::syscall(SYS_gettid)), std::memory_order_relaxed);
+    uint32_t n = count.load(std::memory_order_relaxed);
+    if (n < capacity)
+    {
+        const ResourceRef &resource = lock_resources[id];
+        entries[n].lock.store(id, std::memory_order_relaxed);
+        entries[n].object.store(resource.object, std::memory_order_relaxed);
+        entries[n].kind.store(static_cast<int>(resource.kind), std::memory_order_relaxed);
+        entries[n].since.store(now_ns(), std::memory_order_relaxed);
+        count.store(n + 1, std::memory_order_relaxed);
+    }
+    else
+    {
+        slot.overflow.store(true, std::memory_order_relaxed);
+    }
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+
+    uint32_t used = slots_used.load(std::memory_order_relaxed);
+    while (used <= thread && !slots_used.compare_exchange_weak(used, thread + 1))
+    {
+    }
+}
+
+/**
+ * @brief 从槽位中删除一条记录（用最后一条填补空位），调用者需持有 graph_mutex
+ *
+ * 注销资源或编号被复用时由其它线程调用，写者之间靠 graph_mutex 互斥。
+ */
+void ResourceGraph::publishRemove(ThreadIndex thread, bool wait, LockId id)
+{
+    if (thread >= max_slots)
+    {
+        return;
+    }
+
+    ThreadSlot &slot = slots[thread];
+    auto &count = wait ? slot.wait_count : slot.held_count;
+    SlotEntry *entries = wait ? slot.waits : slot.held;
+
+    uint32_t n = count.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        if (entries[i].lock.load(std::memory_order_relaxed) != id)
+        {
+            continue;
+        }
+
+        uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        SlotEntry &last = entries[n - 1];
+        entries[i].lock.store(last.lock.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        entries[i].object.store(last.object.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        entries[i].kind.store(last.kind.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        entries[i].since.store(last.since.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        count.store(n - 1, std::memory_order_relaxed);
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        return;
+    }
+}
+
+ResourceGraph::Snapshot ResourceGraph::snapshot() const
+{
+    Snapshot result;
+    result.truncated = slots_overflow.load(std::memory_order_relaxed);
+    int64_t now = now_ns();
+
+    uint32_t used = slots_used.load(std::memory_order_acquire);
+    for (ThreadIndex thread = 0; thread < used; ++thread)
+    {
+        const ThreadSlot &slot = slots[thread];
+        std::vector<Snapshot::Edge> holds, waits;
+        long os_id;
+        bool overflow;
+
+        // seqlock：读到奇数或前后序号不同则重读
+        while (true)
+        {
+            holds.clear();
+            waits.clear();
+            uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            os_id = slot.os_id.load(std::memory_order_relaxed);
+            overflow = slot.overflow.load(std::memory_order_relaxed);
+            auto read = [thread, now](const SlotEntry *entries, uint32_t n, std::vector<Snapshot::Edge> &out)
+            {
+                for (uint32_t i = 0; i < n; ++i)
+                {
+                    Snapshot::Edge edge;
+                    edge.thread = thread;
+                    edge.lock = entries[i].lock.load(std::memory_order_relaxed);
+                    edge.resource.object = entries[i].object.load(std::memory_order_relaxed);
+                    edge.resource.kind = static_cast<ResourceKind>(entries[i].kind.load(std::memory_order_relaxed));
+                    edge.duration = std::chrono::nanoseconds(now - entries[i].since.load(std::memory_order_relaxed));
+                    out.push_back(edge);
+                }
+            };
+            uint32_t held_count = std::min<uint32_t>(slot.held_count.load(std::memory_order_relaxed), ThreadSlot::max_held);
+            uint32_t wait_count = std::min<uint32_t>(slot.wait_count.load(std::memory_order_relaxed), ThreadSlot::max_waits);
+            read(slot.held, held_count, holds);
+            read(slot.waits, wait_count, waits);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+            {
+                break;
+            }
+        }
+
+        if (holds.empty() && waits.empty())
+        {
+            continue;
+        }
+        result.truncated = result.truncated || overflow;
+        result.threads.push_back(Snapshot::Thread{thread, os_id});
+        result.holds.insert(result.holds.end(), holds.begin(), holds.end());
+        result.waits.insert(result.waits.end(), waits.begin(), waits.end());
+    }
+    return result;
+}
+
+std::string ResourceGraph::Snapshot::toDot() const
+{
+    std::ostringstream out;
+    out << "digraph ResourceGraph {\n";
+    for (const Thread &thread : threads)
+    {
+        out << "  t" << thread.index << " [shape=box, label=\"thread " << thread.index
+            << "\\ntid " << thread.os_id << "\"];\n";
+    }
+
+    // 资源节点去重：同一资源可能同时被持有和等待
+    std::vector<LockId> locks;
+    auto add_lock = [&locks, &out](const Edge &edge)
+    {
+        for (LockId id : locks)
+        {
+            if (id == edge.lock)
+            {
+                return;
+            }
+        }
+        locks.push_back(edge.lock);
+        out << "  l" << edge.lock << " [shape=ellipse, label=\"" << kind_name(edge.resource.kind)
+            << "\\n" << edge.resource.object << "\"];\n";
+    };
+    for (const Edge &edge : holds)
+    {
+        add_lock(edge);
+    }
+    for (const Edge &edge : waits)
+    {
+        add_lock(edge);
+    }
+
+    for (const Edge &edge : holds)
+    {
+        out << "  l" << edge.lock << " -> t" << edge.thread << " [label=\"held "
+            << to_ms(edge.duration) << "ms\"];\n";
+    }
+    for (const Edge &edge : waits)
+    {
+        out << "  t" << edge.thread << " -> l" << edge.lock << " [style=dashed, color=red, label=\"waiting "
+            << to_ms(edge.duration) << "ms\"];\n";
+    }
+    out << "}\n";
+    return out.str();
+}
+
+std::string ResourceGraph::Snapshot::toJson() const
+{
+    std::ostringstream out;
+    auto edges = [&out](const char *name, const std::vector<Edge> &list)
+    {
+        out << "\"" << name << "\":[";
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            const Edge &edge = list[i];
+            out << (i ? "," : "") << "{\"thread\":" << edge.thread << ",\"lock\":" << edge.lock
+                << ",\"kind\":\"" << kind_name(edge.resource.kind) << "\",\"object\":\""
+                << edge.resource.object << "\",\"duration_ms\":" << to_ms(edge.duration) << "}";
+        }
+        out << "]";
+    };
+
+    out << "{\"threads\":[";
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        out << (i ? "," : "") << "{\"index\":" << threads[i].index << ",\"tid\":" << threads[i].os_id << "}";
+    }
+    out << "],";
+    edges("holds", holds);
+    out << ",";
+    edges("waits", waits);
+    out << ",\"truncated\":" << (truncated ? "true" : "false") << "}\n";
+    return out.str();
+}
+
+void ResourceGraph::enableSignalDump(int signo, int fd, DumpFormat format)
+{
+    bool expected = false;
+    if (!dump_enabled.compare_exchange_strong(expected, true))
+    {
+        throw std::logic_error("ResourceGraph: signal dump already enabled");
+    }
+
+    if (::pipe2(dump_pipe, O_CLOEXEC | O_NONBLOCK) < 0)
+    {
+        dump_enabled = false;
+        throw std::system_error(errno, std::generic_category(), "ResourceGraph: pipe2 failed");
+    }
+    dump_fd = fd;
+    dump_format = format;
+    dump_pipe_write = dump_pipe[1];
+
+    // 读端改回阻塞，后台线程在此等待
+    ::fcntl(dump_pipe[0], F_SETFL, 0);
+    dump_thread = std::thread(&ResourceGraph::dumpLoop, this);
+
+    struct sigaction action{};
+    action.sa_handler = on_dump_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (::sigaction(signo, &action, &previous_action) < 0)
+    {
+        int error = errno;
+        // dump_signal 仍为 -1，不会用未填写的 previous_action 覆盖原处理函数
+        disableSignalDump();
+        throw std::system_error(error, std::generic_category(), "ResourceGraph: sigaction failed");
+    }
+    dump_signal = signo;
+}
+
+void ResourceGraph::disableSignalDump()
+{
+    if (!dump_thread.joinable())
+    {
+        return;
+    }
+
+    if (dump_signal >= 0)
+    {
+        ::sigaction(dump_signal, &previous_action, nullptr);
+    }
+    dump_pipe_write = -1;
+
+    // 已读到旧 fd 的处理函数可能仍在写，等它们结束后才能关闭，否则会写到已关闭或被复用的 fd
+    while (dump_handlers_running.load() != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    // 关闭写端，后台线程读到文件结束后退出
+    ::close(dump_pipe[1]);
+    dump_thread.join();
+    ::close(dump_pipe[0]);
+    dump_pipe[0] = dump_pipe[1] = -1;
+    dump_signal = -1;
+    dump_enabled = false;
+}
+
+void ResourceGraph::dumpLoop()
+{
+    char buffer[64];
+    while (true)
+    {
+        ssize_t n = ::read(dump_pipe[0], buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return;
+        }
+
+        // 连续多个信号合并为一次导出
+        Snapshot current = snapshot();
+        write_all(dump_fd, dump_format == DumpFormat::Dot ? current.toDot() : current.toJson());
+    }
+}
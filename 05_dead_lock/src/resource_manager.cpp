@@ -0,0 +1,323 @@
+#include "resource_manager.hpp"
+#include <stdexcept>
+
+ResourceManager::ResourceManager(Units capacity)
+    : kinds(capacity.size()), available_units(std::move(capacity)), by_need(kinds) {}
+
+ResourceManager::ClientId ResourceManager::addClient(Units max_claim)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (max_claim.size() != kinds)
+    {
+        throw std::invalid_argument("ResourceManager: claim has wrong number of resource kinds");
+    }
+
+    // 最大需求不能超过总量，否则该客户端永远无法完成
+    std::vector<unsigned> total = available_units;
+    for (const Client &c : clients)
+    {
+        if (c.active)
+        {
+            for (size_t j = 0; j < kinds; ++j)
+            {
+                total[j] += c.allocation[j];
+            }
+        }
+    }
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        if (max_claim[j] > total[j])
+        {
+            throw std::invalid_argument("ResourceManager: claim exceeds capacity");
+        }
+    }
+
+    ClientId id = static_cast<ClientId>(clients.size());
+    Client client;
+    client.allocation.assign(kinds, 0);
+    client.max_claim = std::move(max_claim);
+    clients.push_back(std::move(client));
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        by_need[j].emplace(need(id, j), id);
+    }
+    return id;
+}
+
+void ResourceManager::removeClient(ClientId client)
+{
+    std::vector<std::promise<void>> granted;
+    std::vector<std::promise<void>> rejected;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (client >= clients.size() || !clients[client].active)
+        {
+            throw std::invalid_argument("ResourceManager: unknown client");
+        }
+
+        Client &c = clients[client];
+        for (size_t j = 0; j < kinds; ++j)
+        {
+            by_need[j].erase(by_need[j].find({need(client, j), client}));
+            available_units[j] += c.allocation[j];
+            c.allocation[j] = 0;
+        }
+        c.active = false;
+
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (it->client == client)
+            {
+                rejected.push_back(std::move(it->promise));
+                it = pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        grantPending(granted);
+    }
+
+    for (auto &promise : rejected)
+    {
+        promise.set_exception(std::make_exception_ptr(std::runtime_error("ResourceManager: client removed")));
+    }
+    for (auto &promise : granted)
+    {
+        promise.set_value();
+    }
+}
+
+std::future<void> ResourceManager::request(ClientId client, const Units &units)
+{
+    std::vector<std::promise<void>> granted;
+    std::future<void> future;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        validate(client, units);
+
+        std::promise<void> promise;
+        future = promise.get_future();
+
+        // 新申请排到队尾后立即按提交顺序检查一遍：排在前面的不安全申请不会挡住安全的新申请，
+        // 否则可能只剩能完成的客户端在等待，却没有人会再归还资源
+        pending.push_back(Pending{client, units, std::move(promise)});
+        grantPending(granted);
+    }
+
+    for (auto &promise : granted)
+    {
+        promise.set_value();
+    }
+    return future;
+}
+
+bool ResourceManager::tryRequest(ClientId client, const Units &units)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    validate(client, units);
+    return tryGrant(client, units);
+}
+
+void ResourceManager::release(ClientId client, const Units &units)
+{
+    std::vector<std::promise<void>> granted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (client >= clients.size() || !clients[client].active || units.size() != kinds)
+        {
+            throw std::invalid_argument("ResourceManager: unknown client or wrong number of resource kinds");
+        }
+        for (size_t j = 0; j < kinds; ++j)
+        {
+            if (units[j] > clients[client].allocation[j])
+            {
+                throw std::invalid_argument("ResourceManager: releasing more than allocated");
+            }
+        }
+
+        adjust(client, units, false);
+        grantPending(granted);
+    }
+
+    // 在锁外通知，回调可能立即再次申请
+    for (auto &promise : granted)
+    {
+        promise.set_value();
+    }
+}
+
+ResourceManager::Units ResourceManager::available() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return available_units;
+}
+
+ResourceManager::Units ResourceManager::allocation(ClientId client) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (client >= clients.size())
+    {
+        throw std::invalid_argument("ResourceManager: unknown client");
+    }
+    return clients[client].allocation;
+}
+
+size_t ResourceManager::pendingRequests() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.size();
+}
+
+unsigned ResourceManager::need(ClientId client, size_t kind) const
+{
+    return clients[client].max_claim[kind] - clients[client].allocation[kind];
+}
+
+void ResourceManager::validate(ClientId client, const Units &units) const
+{
+    if (client >= clients.size() || !clients[client].active)
+    {
+        throw std::invalid_argument("ResourceManager: unknown client");
+    }
+    if (units.size() != kinds)
+    {
+        throw std::invalid_argument("ResourceManager: request has wrong number of resource kinds");
+    }
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        if (units[j] > need(client, j))
+        {
+            throw std::invalid_argument("ResourceManager: request exceeds declared maximum claim");
+        }
+    }
+}
+
+/**
+ * @brief 分配或归还资源，同时更新有序集合，O(m·log n)
+ */
+void ResourceManager::adjust(ClientId client, const Units &units, bool grant)
+{
+    Client &c = clients[client];
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        if (units[j] == 0)
+        {
+            continue;
+        }
+        by_need[j].erase(by_need[j].find({need(client, j), client}));
+        if (grant)
+        {
+            c.allocation[j] += units[j];
+            available_units[j] -= units[j];
+        }
+        else
+        {
+            c.allocation[j] -= units[j];
+            available_units[j] += units[j];
+        }
+        by_need[j].emplace(need(client, j), client);
+    }
+}
+
+/**
+ * @brief 当前状态是否安全：存在一个顺序使所有客户端都能拿到最大需求并完成
+ *
+ * 每种资源沿按需求排序的集合推进一个游标，需求不超过当前可用量的客户端在该资源上“满足”；
+ * 所有资源都满足的客户端视为完成并归还其分配，可用量增加后游标继续推进。
+ * 每个 (客户端, 资源) 对只被越过一次，总计 O(n·m)。
+ */
+bool ResourceManager::isSafe() const
+{
+    Units work = available_units;
+    std::vector<std::multiset<std::pair<unsigned, ClientId>>::const_iterator> cursor;
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        cursor.push_back(by_need[j].begin());
+    }
+
+    std::vector<size_t> satisfied(clients.size(), 0);
+    std::vector<ClientId> finishable;
+    size_t remaining = 0;
+    for (const Client &c : clients)
+    {
+        remaining += c.active;
+    }
+    if (kinds == 0)
+    {
+        return true;
+    }
+
+    while (true)
+    {
+        for (size_t j = 0; j < kinds; ++j)
+        {
+            while (cursor[j] != by_need[j].end() && cursor[j]->first <= work[j])
+            {
+                ClientId id = cursor[j]->second;
+                if (++satisfied[id] == kinds)
+                {
+                    finishable.push_back(id);
+                }
+                ++cursor[j];
+            }
+        }
+
+        if (finishable.empty())
+        {
+            return remaining == 0;
+        }
+
+        // 完成一个客户端，归还其全部分配
+        ClientId done = finishable.back();
+        finishable.pop_back();
+        remaining--;
+        for (size_t j = 0; j < kinds; ++j)
+        {
+            work[j] += clients[done].allocation[j];
+        }
+    }
+}
+
+/**
+ * @brief 试探性分配，不安全则撤销
+ */
+bool ResourceManager::tryGrant(ClientId client, const Units &units)
+{
+    for (size_t j = 0; j < kinds; ++j)
+    {
+        // 排队期间同一客户端的其它申请可能已被批准，剩余需求不足时继续排队
+        if (units[j] > available_units[j] || units[j] > need(client, j))
+        {
+            return false;
+        }
+    }
+
+    adjust(client, units, true);
+    if (isSafe())
+    {
+        return true;
+    }
+    adjust(client, units, false);
+    return false;
+}
+
+/**
+ * @brief 按提交顺序批准所有现在安全的排队申请，调用者需持有 mutex
+ */
+void ResourceManager::grantPending(std::vector<std::promise<void>> &granted)
+{
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        if (tryGrant(it->client, it->units))
+        {
+            granted.push_back(std::move(it->promise));
+            it = pending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
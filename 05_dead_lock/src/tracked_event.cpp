@@ -0,0 +1,55 @@
+#include "tracked_event.hpp"
+
+TrackedEvent::TrackedEvent(ResourceGraph *g, ResourceGraph::ResourceKind kind)
+    : graph(g), event_id(g->registerResource(this, kind)) {}
+
+TrackedEvent::~TrackedEvent()
+{
+    graph->unregisterLock(event_id);
+}
+
+/**
+ * @brief 登记当前线程为通知方，作用域结束时撤销
+ */
+TrackedEvent::SignalerScope TrackedEvent::signaler()
+{
+    return SignalerScope(this);
+}
+
+void TrackedEvent::beginSignaling()
+{
+    graph->acquireLock(event_id);
+}
+
+void TrackedEvent::endSignaling()
+{
+    graph->releaseLock(event_id);
+}
+
+void TrackedEvent::beginWaiting()
+{
+    graph->waitForLock(event_id);
+}
+
+void TrackedEvent::endWaiting()
+{
+    graph->stopWaiting(event_id);
+}
+
+TrackedEvent::SignalerScope::SignalerScope(TrackedEvent *e) : event(e)
+{
+    event->beginSignaling();
+}
+
+TrackedEvent::SignalerScope::SignalerScope(SignalerScope &&other) noexcept : event(other.event)
+{
+    other.event = nullptr;
+}
+
+TrackedEvent::SignalerScope::~SignalerScope()
+{
+    if (event != nullptr)
+    {
+        event->endSignaling();
+    }
+}
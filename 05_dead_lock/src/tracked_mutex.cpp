@@ -1,7 +1,7 @@
 #include "tracked_mutex.hpp"
 
 TrackedMutex::TrackedMutex(std::mutex *m, ResourceGraph *g)
-    : mtx(m), graph(g) {}
+    : mtx(m), graph(g), lock_id(g->registerLock(m)) {}
 
 TrackedMutex::~TrackedMutex()
 {
@@ -9,37 +9,74 @@ TrackedMutex::~TrackedMutex()
     {
         unlock();
     }
+    graph->unregisterLock(lock_id);
 }
 
 bool TrackedMutex::try_lock()
 {
-    graph->waitForLock(mtx);
+    if (lock_order != nullptr && !lock_order->tryBeforeAcquire(this, lock_class))
+    {
+        return false;
+    }
+    graph->waitForLock(lock_id);
     if (mtx->try_lock())
     {
         locked = true;
-        graph->stopWaiting(mtx);
-        graph->acquireLock(mtx);
+        graph->stopWaiting(lock_id);
+        graph->acquireLock(lock_id);
+        hold_timer.acquired();
         return true;
     }
-    graph->stopWaiting(mtx);
+    graph->stopWaiting(lock_id);
+    if (lock_order != nullptr)
+    {
+        lock_order->acquireFailed(this);
+    }
     return false;
 }
 
 void TrackedMutex::lock()
 {
-    graph->waitForLock(mtx);
+    if (lock_order != nullptr)
+    {
+        lock_order->beforeAcquire(this, lock_class);
+    }
+    graph->waitForLock(lock_id);
     mtx->lock();
     locked = true;
-    graph->stopWaiting(mtx);
-    graph->acquireLock(mtx);
+    graph->stopWaiting(lock_id);
+    graph->acquireLock(lock_id);
+    hold_timer.acquired();
 }
 
 void TrackedMutex::unlock()
 {
     if (locked)
     {
-        graph->releaseLock(mtx);
-        mtx->unlock();
+        if (lock_order != nullptr)
+        {
+            lock_order->release(this);
+        }
+        HoldBudget::Violation violation;
+        const HoldBudget *exceeded = hold_timer.released(mtx, violation);
+        graph->releaseLock(lock_id);
         locked = false;
+        mtx->unlock();
+        // 回调在锁外执行
+        if (exceeded)
+        {
+            exceeded->report(violation);
+        }
     }
-}
\ No newline at end of file
+}
+
+void TrackedMutex::setHoldBudget(const HoldBudget *budget, const char *name)
+{
+    hold_timer.assign(budget, name);
+}
+
+void TrackedMutex::bindClass(const LockOrder &order, const std::string &name)
+{
+    lock_class = order.classId(name);
+    lock_order = &order;
+}
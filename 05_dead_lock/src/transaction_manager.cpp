@@ -0,0 +1,323 @@
+#include "transaction_manager.hpp"
+#include <algorithm>
+
+namespace
+{
+    bool conflicts(TransactionManager::LockMode a, TransactionManager::LockMode b)
+    {
+        return a == TransactionManager::LockMode::Exclusive || b == TransactionManager::LockMode::Exclusive;
+    }
+}
+
+TransactionManager::Transaction::Transaction(TransactionManager *m, uint64_t timestamp)
+    : manager(m), state(std::make_shared<TxnState>(timestamp)) {}
+
+TransactionManager::Transaction::~Transaction()
+{
+    if (state)
+    {
+        abort();
+    }
+}
+
+void TransactionManager::Transaction::lock(Resource &resource, LockMode mode)
+{
+    manager->acquire(state, resource, mode);
+}
+
+void TransactionManager::Transaction::unlock(Resource &resource)
+{
+    std::lock_guard<std::mutex> lock(manager->mutex);
+    if (std::find(state->held.begin(), state->held.end(), &resource) == state->held.end())
+    {
+        throw std::logic_error("TransactionManager: resource is not held by this transaction");
+    }
+    state->shrinking = true;
+    manager->release(*state, resource);
+    state->held.erase(std::find(state->held.begin(), state->held.end(), &resource));
+}
+
+void TransactionManager::Transaction::commit()
+{
+    manager->finish(*state, true);
+}
+
+void TransactionManager::Transaction::abort()
+{
+    manager->finish(*state, false);
+}
+
+bool TransactionManager::Transaction::isShrinking() const
+{
+    std::lock_guard<std::mutex> lock(manager->mutex);
+    return state->shrinking;
+}
+
+TransactionManager::TransactionManager(Policy policy, ResourceGraph *graph)
+    : policy(policy), graph(graph) {}
+
+TransactionManager::Transaction TransactionManager::begin()
+{
+    return Transaction(this, nextTimestamp());
+}
+
+TransactionManager::Statistics TransactionManager::statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+uint64_t TransactionManager::nextTimestamp()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return next_timestamp++;
+}
+
+void TransactionManager::acquire(const std::shared_ptr<TxnState> &txn, Resource &resource, LockMode mode)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (txn->aborted)
+    {
+        throw Aborted("TransactionManager: transaction was wounded by an older one");
+    }
+    if (txn->finished)
+    {
+        throw std::logic_error("TransactionManager: transaction already finished");
+    }
+    if (txn->shrinking)
+    {
+        throw std::logic_error("TransactionManager: lock requested in shrinking phase");
+    }
+
+    auto found = table.find(&resource);
+    if (found == table.end())
+    {
+        found = table.emplace(&resource, LockState()).first;
+        if (graph)
+        {
+            found->second.graph_id = graph->registerLock(&resource.getMutex());
+        }
+    }
+    LockState &state = found->second;
+
+    // 已持有同等或更强的锁
+    for (const Request &request : state.queue)
+    {
+        if (request.txn == txn.get() && request.granted &&
+            (request.mode == LockMode::Exclusive || mode == LockMode::Shared))
+        {
+            return;
+        }
+    }
+    bool upgrade = std::find(txn->held.begin(), txn->held.end(), &resource) != txn->held.end();
+
+    auto request = state.queue.insert(state.queue.end(), Request{txn.get(), mode, false});
+    grant(state);
+
+    if (!request->granted)
+    {
+        // 挡路的事务：冲突的已授予请求，以及排在前面的所有等待请求（FIFO）
+        std::vector<TxnState *> blockers;
+        for (auto it = state.queue.begin(); it != request; ++it)
+        {
+            if (it->txn != txn.get() && (!it->granted || conflicts(it->mode, mode)))
+            {
+                blockers.push_back(it->txn);
+            }
+        }
+
+        if (policy == Policy::WaitDie)
+        {
+            // 年轻的事务不等待较老的，直接中止
+            auto older = std::find_if(blockers.begin(), blockers.end(),
+                                      [&](TxnState *b)
+                                      { return b->timestamp < txn->timestamp; });
+            if (older != blockers.end())
+            {
+                state.queue.erase(request);
+                txn->aborted = true;
+                txn->killer = (*older)->shared_from_this();
+                dropIfIdle(&resource);
+                throw Aborted("TransactionManager: younger transaction died instead of waiting");
+            }
+        }
+        else
+        {
+            // 较老的事务中止挡路的年轻事务，然后等待它们释放
+            for (TxnState *blocker : blockers)
+            {
+                if (blocker->timestamp > txn->timestamp)
+                {
+                    wound(*blocker, txn);
+                }
+            }
+        }
+
+        if (!request->granted)
+        {
+            stats.waits++;
+            txn->waiting_on = &resource;
+            txn->waiting_request = request;
+            // 升级时本事务已以同一编号持有该锁，登记等待会在图中形成自环；
+            // 升级等待由时间戳策略保证不成环，不登记
+            // 被 wound 后请求已移除，其它事务释放时可能删掉该资源的 state，醒来后不能再访问它
+            ResourceGraph::LockId graph_id = state.graph_id;
+            if (graph && !upgrade)
+            {
+                graph->waitForLock(graph_id);
+            }
+            txn->cv.wait(lock, [&]()
+                         { return txn->waiting_on == nullptr || request->granted; });
+            if (graph && !upgrade)
+            {
+                graph->stopWaiting(graph_id);
+            }
+            // 被 wound 时请求已从队列移除
+            if (txn->waiting_on == nullptr)
+            {
+                dropIfIdle(&resource);
+                throw Aborted("TransactionManager: transaction was wounded by an older one");
+            }
+            txn->waiting_on = nullptr;
+        }
+    }
+
+    if (!upgrade)
+    {
+        txn->held.push_back(&resource);
+        if (graph)
+        {
+            graph->acquireLock(state.graph_id);
+        }
+    }
+}
+
+/**
+ * @brief 按到达顺序授予请求，遇到第一个无法授予的等待请求就停止
+ */
+void TransactionManager::grant(LockState &state)
+{
+    for (auto it = state.queue.begin(); it != state.queue.end(); ++it)
+    {
+        if (it->granted)
+        {
+            continue;
+        }
+        for (const Request &other : state.queue)
+        {
+            if (other.granted && other.txn != it->txn && conflicts(other.mode, it->mode))
+            {
+                return;
+            }
+        }
+
+        // 升级时去掉同一事务原来的共享锁
+        for (auto other = state.queue.begin(); other != state.queue.end();)
+        {
+            if (other != it && other->txn == it->txn)
+            {
+                other = state.queue.erase(other);
+            }
+            else
+            {
+                ++other;
+            }
+        }
+        it->granted = true;
+        it->txn->cv.notify_one();
+    }
+}
+
+/**
+ * @brief 标记较年轻的事务为中止；它正在等待时立即唤醒，否则在下一次加锁时发现
+ *
+ * 已提交的事务不受影响，较老的事务只需等它释放。
+ * 请求已被授予但线程尚未醒来时不撤销请求，它醒来后照常持有，在下一次加锁时中止。
+ */
+void TransactionManager::wound(TxnState &victim, const std::shared_ptr<TxnState> &by)
+{
+    if (victim.finished || victim.aborted)
+    {
+        return;
+    }
+    victim.aborted = true;
+    victim.killer = by;
+    if (victim.waiting_on != nullptr && !victim.waiting_request->granted)
+    {
+        LockState &state = table.at(victim.waiting_on);
+        state.queue.erase(victim.waiting_request);
+        victim.waiting_on = nullptr;
+        grant(state);
+        victim.cv.notify_one();
+    }
+}
+
+/**
+ * @brief 释放事务对一个资源的锁，调用者需持有 mutex
+ */
+void TransactionManager::release(TxnState &txn, Resource &resource)
+{
+    LockState &state = table.at(&resource);
+    state.queue.remove_if([&](const Request &request)
+                          { return request.txn == &txn && request.granted; });
+    if (graph)
+    {
+        graph->releaseLock(state.graph_id);
+    }
+    grant(state);
+    dropIfIdle(&resource);
+}
+
+void TransactionManager::dropIfIdle(Resource *resource)
+{
+    auto found = table.find(resource);
+    if (found != table.end() && found->second.queue.empty())
+    {
+        if (graph)
+        {
+            graph->unregisterLock(found->second.graph_id);
+        }
+        table.erase(found);
+    }
+}
+
+void TransactionManager::finish(TxnState &txn, bool committed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (txn.finished)
+        {
+            return;
+        }
+        for (auto it = txn.held.rbegin(); it != txn.held.rend(); ++it)
+        {
+            release(txn, **it);
+        }
+        txn.held.clear();
+        txn.finished = true;
+        txn.shrinking = true;
+        if (committed)
+        {
+            stats.committed++;
+        }
+        else
+        {
+            stats.aborted++;
+        }
+    }
+    finished_cv.notify_all();
+}
+
+/**
+ * @brief 重试前等待导致中止的事务结束，避免立即再次撞上同一个冲突
+ */
+void TransactionManager::waitForKiller(TxnState &txn)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (txn.killer)
+    {
+        std::shared_ptr<TxnState> killer = txn.killer;
+        finished_cv.wait(lock, [&]()
+                         { return killer->finished; });
+    }
+}
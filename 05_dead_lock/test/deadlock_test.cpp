@@ -1,8 +1,27 @@
 #include <iostream>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
 #include "resource_graph.hpp"
 #include "tracked_mutex.hpp"
 #include "hierarchical_mutex.hpp"
+#include "tracked_event.hpp"
+#include "resource_manager.hpp"
+#include "object_pool.hpp"
+#include "resource.hpp"
+#include "transaction_manager.hpp"
+#include "hold_budget.hpp"
+#include "lock_order.hpp"
+#include <sstream>
 
 void test_resource_graph()
 {
@@ -20,6 +39,864 @@ void test_resource_graph()
     assert(!graph.hasDeadlock());
 }
 
+/**
+ * @brief 在独立线程中依次执行各步骤，全部完成后才让线程退出
+ *
+ * 线程编号在线程退出后会被复用，检测期间参与的线程必须保持存活
+ */
+class StepThreads
+{
+private:
+    std::vector<std::thread> threads;
+    std::atomic<int> turn{0};
+    std::atomic<bool> finish{false};
+
+public:
+    explicit StepThreads(std::vector<std::vector<std::function<void()>>> steps)
+    {
+        // steps[t][k] 在全局第 k * threads + t 轮执行，即各线程轮流执行第 k 步
+        int count = static_cast<int>(steps.size());
+        for (int t = 0; t < count; ++t)
+        {
+            threads.emplace_back([this, t, count, thread_steps = steps[t]]()
+                                 {
+                for (size_t k = 0; k < thread_steps.size(); ++k)
+                {
+                    int my_turn = static_cast<int>(k) * count + t;
+                    while (turn != my_turn)
+                    {
+                        std::this_thread::yield();
+                    }
+                    thread_steps[k]();
+                    turn++;
+                }
+                while (!finish)
+                {
+                    std::this_thread::yield();
+                } });
+        }
+    }
+
+    void waitSteps(int total)
+    {
+        while (turn < total)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    ~StepThreads()
+    {
+        finish = true;
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+};
+
+void test_deadlock_cycle()
+{
+    ResourceGraph graph;
+    std::mutex m1, m2, m3;
+
+    // 三个线程各持有一个锁并等待下一个线程的锁，形成环
+    {
+        StepThreads threads({{[&]
+                              { graph.acquireLock(&m1); },
+                              [&]
+                              { graph.waitForLock(&m2); }},
+                             {[&]
+                              { graph.acquireLock(&m2); },
+                              [&]
+                              { graph.waitForLock(&m3); }},
+                             {[&]
+                              { graph.acquireLock(&m3); },
+                              [&]
+                              { graph.waitForLock(&m1); }}});
+        threads.waitSteps(6);
+        assert(graph.hasDeadlock());
+    }
+
+    // 链状等待不构成死锁
+    ResourceGraph chain;
+    {
+        StepThreads threads({{[&]
+                              { chain.acquireLock(&m1); },
+                              [&]
+                              { chain.waitForLock(&m2); }},
+                             {[&]
+                              { chain.acquireLock(&m2); },
+                              [&]
+                              { chain.waitForLock(&m3); }}});
+        threads.waitSteps(4);
+        assert(!chain.hasDeadlock());
+    }
+}
+
+void test_find_deadlocks()
+{
+    ResourceGraph graph;
+    std::mutex m1, m2, m3, m4, m5;
+    auto hold_then_wait = [&graph](std::mutex *held, std::mutex *wanted)
+    {
+        return std::vector<std::function<void()>>{[&graph, held]
+                                                  { graph.acquireLock(held); },
+                                                  [&graph, wanted]
+                                                  { graph.waitForLock(wanted); }};
+    };
+
+    // 两个互不相关的环，另有一个线程等待环上的锁但自身不在环上
+    StepThreads threads({hold_then_wait(&m1, &m2),
+                         hold_then_wait(&m2, &m1),
+                         hold_then_wait(&m3, &m4),
+                         hold_then_wait(&m4, &m3),
+                         hold_then_wait(&m5, &m1)});
+    threads.waitSteps(10);
+
+    auto deadlocks = graph.findDeadlocks();
+    assert(deadlocks.size() == 2);
+    for (const auto &deadlock : deadlocks)
+    {
+        assert(deadlock.threads.size() == 2);
+        for (const auto &thread : deadlock.threads)
+        {
+            assert(thread.held.size() == 1 && thread.waiting_for.size() == 1);
+            assert(thread.held[0].object != &m5);
+            assert(thread.blocked_by.size() == 1 && thread.blocked_by[0] != thread.index);
+            assert(thread.id != std::this_thread::get_id());
+            assert(thread.waited.count() >= 0);
+        }
+    }
+
+    // 检测不修改图，可重复调用
+    assert(graph.findDeadlocks().size() == 2);
+    assert(graph.hasDeadlock());
+}
+
+/**
+ * @brief 轮询直到检测到恰好一组死锁
+ */
+ResourceGraph::Deadlock wait_for_deadlock(ResourceGraph &graph)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto deadlocks = graph.findDeadlocks();
+        if (!deadlocks.empty())
+        {
+            assert(deadlocks.size() == 1);
+            return deadlocks[0];
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    assert(false && "deadlock not detected");
+    return {};
+}
+
+bool waits_on(const ResourceGraph::Deadlock &deadlock, ResourceGraph::ResourceKind kind)
+{
+    for (const auto &thread : deadlock.threads)
+    {
+        for (const auto &resource : thread.waiting_for)
+        {
+            if (resource.kind == kind)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void test_condition_variable_cycle()
+{
+    ResourceGraph graph;
+    std::mutex m, cv_mutex;
+    TrackedConditionVariable cv(&graph);
+    bool ready = false;
+    std::atomic<bool> locked{false};
+
+    // A 持有 m 等待通知；唯一的通知方 B 在等 m
+    std::thread a([&]()
+                  {
+        TrackedMutex tracked(&m, &graph);
+        tracked.lock();
+        locked = true;
+        std::unique_lock<std::mutex> lock(cv_mutex);
+        cv.wait(lock, [&ready] { return ready; });
+        lock.unlock();
+        tracked.unlock(); });
+
+    std::thread b([&]()
+                  {
+        auto scope = cv.signaler();
+        while (!locked)
+        {
+            std::this_thread::yield();
+        }
+        TrackedMutex tracked(&m, &graph);
+        tracked.lock();
+        tracked.unlock(); });
+
+    auto deadlock = wait_for_deadlock(graph);
+    assert(deadlock.threads.size() == 2);
+    assert(waits_on(deadlock, ResourceGraph::ResourceKind::ConditionVariable));
+    assert(waits_on(deadlock, ResourceGraph::ResourceKind::Mutex));
+
+    // 由测试线程代为通知，解开死锁
+    {
+        std::lock_guard<std::mutex> lock(cv_mutex);
+        ready = true;
+    }
+    cv.notify_all();
+    a.join();
+    b.join();
+    assert(graph.findDeadlocks().empty());
+}
+
+void test_future_cycle()
+{
+    ResourceGraph graph;
+    std::mutex m;
+    auto producer = TrackedFuture<std::future<int>>::makeProducer(&graph);
+    std::promise<int> promise;
+    TrackedFuture<std::future<int>> future(promise.get_future(), producer);
+    std::atomic<bool> locked{false};
+    std::atomic<bool> release{false};
+
+    // 生产方需要消费者持有的锁才能产生结果
+    std::thread b([&]()
+                  {
+        auto scope = producer->signaler();
+        while (!locked)
+        {
+            std::this_thread::yield();
+        }
+        graph.waitForLock(&m);
+        while (!release)
+        {
+            std::this_thread::yield();
+        }
+        graph.stopWaiting(&m);
+        promise.set_value(42); });
+
+    TrackedMutex tracked(&m, &graph);
+    tracked.lock();
+    locked = true;
+    std::thread checker([&]()
+                        {
+        auto deadlock = wait_for_deadlock(graph);
+        assert(deadlock.threads.size() == 2);
+        assert(waits_on(deadlock, ResourceGraph::ResourceKind::Future));
+        release = true; });
+
+    assert(future.get() == 42);
+    tracked.unlock();
+    checker.join();
+    b.join();
+}
+
+void test_snapshot_export()
+{
+    ResourceGraph graph;
+    std::mutex m1, m2;
+
+    // 一个线程持有 m1 等待 m2，另一个线程持有 m2
+    StepThreads threads({{[&]
+                          { graph.acquireLock(&m1); },
+                          [&]
+                          { graph.waitForLock(&m2); }},
+                         {[&]
+                          { graph.acquireLock(&m2); }}});
+    threads.waitSteps(3);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+    auto snapshot = graph.snapshot();
+    assert(snapshot.threads.size() == 2);
+    assert(snapshot.holds.size() == 2 && snapshot.waits.size() == 1);
+    assert(snapshot.waits[0].resource.object == &m2);
+    assert(snapshot.waits[0].duration >= std::chrono::milliseconds(5));
+    for (const auto &hold : snapshot.holds)
+    {
+        assert(hold.duration >= snapshot.waits[0].duration);
+    }
+    assert(!snapshot.truncated);
+
+    std::string dot = snapshot.toDot();
+    assert(dot.find("digraph") == 0 && dot.find("waiting") != std::string::npos);
+    std::string json = snapshot.toJson();
+    assert(json.find("\"waits\":[{") != std::string::npos);
+
+    // 信号触发的导出写到管道
+    int fds[2];
+    assert(::pipe(fds) == 0);
+    graph.enableSignalDump(SIGUSR2, fds[1], ResourceGraph::DumpFormat::Json);
+    bool rejected = false;
+    ResourceGraph other;
+    try
+    {
+        other.enableSignalDump(SIGUSR2, fds[1]);
+    }
+    catch (const std::logic_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+
+    std::raise(SIGUSR2);
+    pollfd ready{fds[0], POLLIN, 0};
+    assert(::poll(&ready, 1, 5000) == 1);
+    char buffer[4096];
+    ssize_t n = ::read(fds[0], buffer, sizeof(buffer));
+    assert(n > 0 && buffer[0] == '{');
+    graph.disableSignalDump();
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+void test_bankers_algorithm()
+{
+    using namespace std::chrono_literals;
+
+    // 教科书中的例子：三种资源，五个客户端
+    ResourceManager manager({10, 5, 7});
+    std::vector<ResourceManager::Units> max = {{7, 5, 3}, {3, 2, 2}, {9, 0, 2}, {2, 2, 2}, {4, 3, 3}};
+    std::vector<ResourceManager::Units> held = {{0, 1, 0}, {2, 0, 0}, {3, 0, 2}, {2, 1, 1}, {0, 0, 2}};
+    std::vector<ResourceManager::ClientId> ids;
+    for (size_t i = 0; i < max.size(); ++i)
+    {
+        ids.push_back(manager.addClient(max[i]));
+        assert(manager.tryRequest(ids[i], held[i]));
+    }
+    assert((manager.available() == ResourceManager::Units{3, 3, 2}));
+
+    // P1 申请 (1,0,2) 后仍安全，立即批准
+    auto p1 = manager.request(ids[1], {1, 0, 2});
+    assert(p1.wait_for(0s) == std::future_status::ready);
+
+    // P4 申请 (3,3,0) 超过可用量，P0 申请 (0,2,0) 会进入不安全状态，都排队
+    auto p4 = manager.request(ids[4], {3, 3, 0});
+    auto p0 = manager.request(ids[0], {0, 2, 0});
+    assert(p4.wait_for(0s) == std::future_status::timeout);
+    assert(p0.wait_for(0s) == std::future_status::timeout);
+    assert(manager.pendingRequests() == 2);
+    assert(!manager.tryRequest(ids[0], {0, 2, 0}));
+
+    // 超过声明的最大需求直接拒绝
+    bool rejected = false;
+    try
+    {
+        manager.request(ids[3], {1, 1, 1});
+    }
+    catch (const std::invalid_argument &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // P1 完成并归还后 P4 的申请变得可行；P0 的申请要等 P4 也归还
+    manager.release(ids[1], manager.allocation(ids[1]));
+    assert(p4.wait_for(0s) == std::future_status::ready);
+    assert(p0.wait_for(0s) == std::future_status::timeout);
+    manager.release(ids[4], manager.allocation(ids[4]));
+    assert(p0.wait_for(0s) == std::future_status::ready);
+    assert(manager.pendingRequests() == 0);
+
+    // 注销客户端时未批准的申请以异常结束
+    auto blocked = manager.request(ids[2], {6, 0, 0});
+    assert(blocked.wait_for(0s) == std::future_status::timeout);
+    manager.removeClient(ids[2]);
+    bool cancelled = false;
+    try
+    {
+        blocked.get();
+    }
+    catch (const std::runtime_error &)
+    {
+        cancelled = true;
+    }
+    assert(cancelled);
+
+    // 排在前面的不安全申请不能挡住安全的新申请：X 是唯一能完成的客户端，必须立即批准
+    ResourceManager small({2});
+    auto x = small.addClient({2});
+    auto y = small.addClient({2});
+    assert(small.request(x, {1}).wait_for(0s) == std::future_status::ready);
+    auto y_request = small.request(y, {1});
+    assert(y_request.wait_for(0s) == std::future_status::timeout);
+    assert(small.request(x, {1}).wait_for(0s) == std::future_status::ready);
+    assert(small.pendingRequests() == 1);
+    small.release(x, {2});
+    assert(y_request.wait_for(0s) == std::future_status::ready);
+}
+
+void test_object_pool()
+{
+    // 借出的对象各不相同，耗尽时返回空 Lease，归还后可再次借出
+    ObjectPool<Resource> pool(4, [](size_t i) { return Resource(static_cast<int>(i)); }, 2);
+    std::vector<ObjectPool<Resource>::Lease> leases;
+    int id_sum = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        leases.push_back(pool.acquire());
+        assert(leases.back());
+        id_sum += leases.back()->getId();
+    }
+    assert(id_sum == 0 + 1 + 2 + 3);
+    assert(!pool.acquire());
+    leases.pop_back();
+    auto again = pool.acquire();
+    assert(again);
+    std::lock_guard<std::mutex> lock(again->getMutex());
+    leases.clear();
+
+    // 多线程反复借还，同一对象不会同时被两个线程持有
+    struct Counter
+    {
+        std::atomic<int> users{0};
+    };
+    const int thread_count = 4;
+    ObjectPool<Counter> counters(thread_count * 8, [](size_t) { return Counter(); }, 4);
+    std::atomic<bool> overlap{false};
+    std::atomic<int> acquired{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&]()
+                             {
+            for (int i = 0; i < 20000; ++i)
+            {
+                auto a = counters.acquire();
+                auto b = counters.acquire();
+                for (auto *lease : {&a, &b})
+                {
+                    if (*lease)
+                    {
+                        acquired++;
+                        if ((*lease)->users.fetch_add(1) != 0)
+                        {
+                            overlap = true;
+                        }
+                    }
+                }
+                for (auto *lease : {&a, &b})
+                {
+                    if (*lease)
+                    {
+                        (*lease)->users.fetch_sub(1);
+                    }
+                }
+            } });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+    assert(!overlap);
+    assert(acquired > 0);
+
+    // 线程退出时缓存归还全局链表，主线程能借出全部对象
+    std::vector<ObjectPool<Counter>::Lease> all;
+    for (size_t i = 0; i < counters.capacity(); ++i)
+    {
+        all.push_back(counters.acquire());
+        assert(all.back());
+    }
+    assert(!counters.acquire());
+
+    // 同一线程反复创建和销毁池：池销毁后对象立即析构，线程缓存不会让它们继续存活
+    struct Tracked
+    {
+        static int &live()
+        {
+            static int count = 0;
+            return count;
+        }
+        Tracked() { live()++; }
+        ~Tracked() { live()--; }
+    };
+    for (int round = 0; round < 1000; ++round)
+    {
+        ObjectPool<Tracked> temporary(8, [](size_t) { return Tracked(); }, 2);
+        auto a = temporary.acquire();
+        auto b = temporary.acquire();
+        assert(a && b && Tracked::live() == 8);
+    }
+    assert(Tracked::live() == 0);
+
+    // 其它 thread_local 持有的 Lease 在缓存表析构之后才归还，直接回到全局链表
+    using CounterLease = ObjectPool<Counter>::Lease;
+    ObjectPool<Counter> late(2, [](size_t) { return Counter(); }, 1);
+    std::thread([&late]()
+                {
+        thread_local std::unique_ptr<CounterLease> held;
+        if (!held) // 先构造 held，使它晚于缓存表析构
+        {
+            held.reset(new CounterLease(late.acquire()));
+        }
+        assert(*held); })
+        .join();
+    auto first = late.acquire(), second = late.acquire();
+    assert(first && second);
+
+    // 下标为 32 位，UINT32_MAX 是链表结束标记
+    bool rejected = false;
+    try
+    {
+        ObjectPool<int> too_big(size_t(UINT32_MAX), [](size_t) { return 0; });
+    }
+    catch (const std::length_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+}
+
+void test_transactions()
+{
+    using namespace std::chrono_literals;
+    using Mode = TransactionManager::LockMode;
+    Resource r1(1), r2(2);
+
+    // 共享锁兼容，释放后进入收缩阶段，不能再加锁
+    {
+        TransactionManager manager;
+        auto t1 = manager.begin();
+        auto t2 = manager.begin();
+        t1.lockShared(r1);
+        t2.lockShared(r1);
+        t1.unlock(r1);
+        assert(t1.isShrinking());
+        bool violated = false;
+        try
+        {
+            t1.lock(r2, Mode::Exclusive);
+        }
+        catch (const std::logic_error &)
+        {
+            violated = true;
+        }
+        assert(violated);
+    }
+
+    // WaitDie：年轻事务遇到较老的持有者直接中止，较老事务等待年轻的持有者
+    {
+        TransactionManager manager(TransactionManager::Policy::WaitDie);
+        auto older = manager.begin();
+        auto younger = manager.begin();
+        older.lockExclusive(r1);
+        bool died = false;
+        try
+        {
+            younger.lockShared(r1);
+        }
+        catch (const TransactionManager::Aborted &)
+        {
+            died = true;
+        }
+        assert(died);
+        younger.abort();
+
+        auto young = manager.begin();
+        young.lockExclusive(r2);
+        auto waiter = std::async(std::launch::async, [&]()
+                                 { older.lockShared(r2); });
+        assert(waiter.wait_for(20ms) == std::future_status::timeout);
+        young.commit();
+        waiter.get();
+        older.commit();
+        assert(manager.statistics().waits == 1);
+    }
+
+    // WoundWait：较老事务中止挡路的年轻事务，年轻事务在下一次加锁时发现
+    {
+        TransactionManager manager(TransactionManager::Policy::WoundWait);
+        auto older = manager.begin();
+        auto younger = manager.begin();
+        younger.lockExclusive(r1);
+        auto waiter = std::async(std::launch::async, [&]()
+                                 { older.lockExclusive(r1); });
+        assert(waiter.wait_for(20ms) == std::future_status::timeout);
+        bool wounded = false;
+        try
+        {
+            younger.lockShared(r2);
+        }
+        catch (const TransactionManager::Aborted &)
+        {
+            wounded = true;
+        }
+        assert(wounded);
+        younger.abort();
+        waiter.get();
+        older.commit();
+    }
+
+    // 多线程以相反顺序转账，两种策略下都能全部完成且总额不变，结束后资源图中没有残留的持有和等待
+    for (auto policy : {TransactionManager::Policy::WaitDie, TransactionManager::Policy::WoundWait})
+    {
+        ResourceGraph graph;
+        TransactionManager manager(policy, &graph);
+        std::vector<std::unique_ptr<Resource>> accounts;
+        std::vector<int> balance(4, 100);
+        for (int i = 0; i < 4; ++i)
+        {
+            accounts.push_back(std::make_unique<Resource>(i));
+        }
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&, t]()
+                                 {
+                for (int i = 0; i < 50; ++i)
+                {
+                    int from = (t + i) % 4;
+                    int to = (t + i + 1 + t % 2) % 4;
+                    manager.run([&](TransactionManager::Transaction &txn)
+                                {
+                        txn.lockShared(*accounts[from]);
+                        std::this_thread::yield();
+                        txn.lockExclusive(*accounts[to]);
+                        txn.lockExclusive(*accounts[from]);
+                        balance[from] -= 1;
+                        balance[to] += 1; });
+                } });
+        }
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+        auto snapshot = graph.snapshot();
+        assert(snapshot.holds.empty() && snapshot.waits.empty());
+        assert(balance[0] + balance[1] + balance[2] + balance[3] == 400);
+        assert(manager.statistics().committed == 200);
+    }
+}
+
+void test_hold_budget()
+{
+    using namespace std::chrono_literals;
+    std::vector<HoldBudget::Violation> violations;
+    bool released_before_callback = false;
+    std::mutex m;
+    HoldBudget budget(1ms, [&](const HoldBudget::Violation &v)
+                      {
+        violations.push_back(v);
+        // 回调在锁外执行
+        if (v.lock == &m && m.try_lock())
+        {
+            released_before_callback = true;
+            m.unlock();
+        } });
+
+    // 超出预算时报告锁、名字、持有线程和时长，未超出时不报告
+    ResourceGraph graph;
+    TrackedMutex tracked(&m, &graph);
+    tracked.setHoldBudget(&budget, "cache.write");
+    tracked.lock();
+    tracked.unlock();
+    assert(violations.empty());
+    tracked.lock();
+    std::this_thread::sleep_for(5ms);
+    tracked.unlock();
+    assert(violations.size() == 1);
+    assert(violations[0].lock == &m && std::string(violations[0].name) == "cache.write");
+    assert(violations[0].holder == std::this_thread::get_id());
+    assert(violations[0].held >= 5ms && violations[0].budget == 1ms);
+    assert(released_before_callback);
+
+    // 抽样：每两次获取计时一次
+    HoldBudget sampled(1ms, [&](const HoldBudget::Violation &v)
+                       { violations.push_back(v); }, 2);
+    HierarchicalMutex level(500);
+    level.setHoldBudget(&sampled);
+    for (int i = 0; i < 4; ++i)
+    {
+        std::lock_guard<HierarchicalMutex> guard(level);
+        std::this_thread::sleep_for(2ms);
+    }
+    assert(violations.size() == 3);
+    assert(violations[2].lock == &level && violations[2].name == nullptr);
+}
+
+void test_lock_order()
+{
+    static constexpr LockOrder::Rule rules[] = {{"config", "cache"}, {"cache", "db"}, {"config", "log"}};
+    LockOrder order(rules);
+
+    // 顺序是传递的，未声明顺序的锁类不能嵌套
+    auto config = order.classId("config"), cache = order.classId("cache"), db = order.classId("db"), log = order.classId("log");
+    assert(order.allowed(config, db) && order.allowed(cache, db));
+    assert(!order.allowed(db, cache) && !order.allowed(cache, log) && !order.allowed(db, db));
+    assert(order.level(config) > order.level(cache) && order.level(cache) > order.level(db));
+
+    // 绑定锁类的 HierarchicalMutex：中间的锁提前释放后仍按持有的锁检查
+    HierarchicalMutex config_mutex(order, "config"), cache_mutex(order, "cache"), db_mutex(order, "db");
+    config_mutex.lock();
+    db_mutex.lock();
+    config_mutex.unlock();
+    bool violated = false;
+    try
+    {
+        cache_mutex.lock();
+    }
+    catch (const std::runtime_error &e)
+    {
+        violated = std::string(e.what()).find("acquiring cache while holding db") != std::string::npos;
+    }
+    assert(violated);
+    assert(!cache_mutex.try_lock());
+
+    // LogOnly 只记录，Off 不检查
+    std::vector<std::string> logged;
+    order.setLogger([&](const std::string &message)
+                    { logged.push_back(message); });
+    order.setMode(LockOrder::Mode::LogOnly);
+    cache_mutex.lock();
+    cache_mutex.unlock();
+    assert(logged.size() == 1);
+    order.setMode(LockOrder::Mode::Off);
+    cache_mutex.lock();
+    cache_mutex.unlock();
+    assert(logged.size() == 1);
+
+    // LogOnly 下违规获取的锁也入栈，之后仍和更早持有的锁比较：
+    // 持有 db、cache 时再获取 db 类的锁，相对 cache 合法，相对 db 违规
+    HierarchicalMutex db_mutex2(order, "db");
+    order.setMode(LockOrder::Mode::LogOnly);
+    cache_mutex.lock();
+    db_mutex2.lock();
+    assert(logged.size() == 3 && logged[2].find("acquiring db while holding db") != std::string::npos);
+    db_mutex2.unlock();
+    cache_mutex.unlock();
+    db_mutex.unlock();
+
+    // Off 下获取的锁同样记录，切换到 Fail 后参与检查
+    order.setMode(LockOrder::Mode::Off);
+    db_mutex.lock();
+    order.setMode(LockOrder::Mode::Fail);
+    assert(!cache_mutex.try_lock());
+    db_mutex.unlock();
+
+    // 绑定锁类的 TrackedMutex
+    ResourceGraph graph;
+    std::mutex m1, m2;
+    TrackedMutex cache_tracked(&m1, &graph), db_tracked(&m2, &graph);
+    cache_tracked.bindClass(order, "cache");
+    db_tracked.bindClass(order, "db");
+    cache_tracked.lock();
+    db_tracked.lock();
+    db_tracked.unlock();
+    cache_tracked.unlock();
+    db_tracked.lock();
+    assert(!cache_tracked.try_lock());
+    db_tracked.unlock();
+
+    // 配置文件：每行一条链，环和语法错误在加载时报告
+    std::istringstream config_file("# 全局加锁顺序\nconfig -> cache -> db\nlog  # 只声明\n");
+    auto parsed = LockOrder::parse(config_file);
+    assert(parsed->classCount() == 4 && parsed->allowed(parsed->classId("config"), parsed->classId("db")));
+    for (const char *bad : {"a -> b\nb -> a\n", "a -> -> b\n"})
+    {
+        std::istringstream in(bad);
+        bool rejected = false;
+        try
+        {
+            LockOrder::parse(in);
+        }
+        catch (const std::invalid_argument &)
+        {
+            rejected = true;
+        }
+        assert(rejected);
+    }
+
+    // 200 个锁类的链
+    std::vector<std::string> names;
+    for (int i = 0; i < 200; ++i)
+    {
+        names.push_back("class" + std::to_string(i));
+    }
+    std::vector<LockOrder::Rule> chain;
+    for (int i = 0; i + 1 < 200; ++i)
+    {
+        chain.push_back({names[i].c_str(), names[i + 1].c_str()});
+    }
+    LockOrder large(chain);
+    assert(large.allowed(large.classId("class0"), large.classId("class199")));
+    assert(!large.allowed(large.classId("class199"), large.classId("class0")));
+    assert(large.level(large.classId("class0")) == 200);
+}
+
+void test_lock_ids()
+{
+    ResourceGraph graph;
+    std::mutex m1, m2;
+
+    // 同一个互斥锁总是得到同一编号，引用全部释放后编号被复用
+    auto a = graph.registerLock(&m1);
+    auto b = graph.registerLock(&m1);
+    auto c = graph.registerLock(&m2);
+    assert(a == b && a != c);
+    graph.unregisterLock(a);
+    graph.unregisterLock(b);
+    assert(graph.registerLock(&m2) == c);
+    std::mutex m3;
+    assert(graph.registerLock(&m3) == a);
+
+    // 包装器使用注册的编号追踪
+    {
+        TrackedMutex tracked(&m1, &graph);
+        tracked.lock();
+        assert(!graph.hasDeadlock());
+        tracked.unlock();
+    }
+
+    // 重复锁定已持有的非递归互斥锁：单个线程的自环也是死锁
+    std::mutex self;
+    graph.acquireLock(&self);
+    graph.waitForLock(&self);
+    assert(graph.hasDeadlock());
+    auto deadlocks = graph.findDeadlocks();
+    assert(deadlocks.size() == 1 && deadlocks[0].threads.size() == 1);
+    graph.stopWaiting(&self);
+    graph.releaseLock(&self);
+    assert(!graph.hasDeadlock());
+
+    // 持有中的锁被注销，复用其编号的新锁不继承旧的持有关系
+    std::mutex dropped, reused;
+    auto dropped_id = graph.registerLock(&dropped);
+    graph.acquireLock(dropped_id);
+    graph.unregisterLock(dropped_id);
+    auto reused_id = graph.registerLock(&reused);
+    assert(reused_id == dropped_id);
+    graph.waitForLock(reused_id);
+    assert(!graph.hasDeadlock());
+    graph.stopWaiting(reused_id);
+    assert(graph.snapshot().holds.empty());
+    graph.unregisterLock(reused_id);
+
+    // 其它线程得到不同的编号，线程退出后编号被复用，且不继承旧线程未释放的锁
+    std::mutex leaked, other;
+    ResourceGraph::ThreadIndex first = 0, second = 0;
+    std::thread([&]
+                {
+        first = ResourceGraph::currentThread();
+        graph.acquireLock(&leaked); })
+        .join();
+    assert(first != ResourceGraph::currentThread());
+    std::thread([&]
+                {
+        second = ResourceGraph::currentThread();
+        graph.acquireLock(&other);
+        graph.releaseLock(&other); })
+        .join();
+    assert(second == first);
+    assert(graph.snapshot().holds.empty());
+}
+
 void test_hierarchical_mutex()
 {
     HierarchicalMutex high(2000);
@@ -44,11 +921,56 @@ void test_hierarchical_mutex()
         low.unlock();
     }
     assert(exception_caught);
+
+    // 不按逆序释放：释放高层级锁后仍受低层级锁约束，全部释放后可重新从高层级开始
+    HierarchicalMutex middle(1500);
+    high.lock();
+    int middle_line = __LINE__ + 1;
+    middle.lock();
+    assert(HierarchicalMutex::heldCount() == 2);
+    assert(high.isHeldByCurrentThread() && middle.isHeldByCurrentThread());
+    high.unlock();
+    auto held = HierarchicalMutex::heldLocks();
+    assert(held.size() == 1 && held[0].mutex == &middle && held[0].level == 1500);
+    assert(held[0].line == middle_line && std::string(held[0].file).find("deadlock_test") != std::string::npos);
+    assert(!high.try_lock());
+    low.lock();
+
+    // 持锁经过阻塞点时报告持有的锁
+    bool reported = false;
+    try
+    {
+        HierarchicalMutex::assertNoLocksHeld("future wait");
+    }
+    catch (const std::logic_error &e)
+    {
+        reported = std::string(e.what()).find("level 1000") != std::string::npos;
+    }
+    assert(reported);
+    middle.unlock();
+    low.unlock();
+    HierarchicalMutex::assertNoLocksHeld("future wait");
+    {
+        std::lock_guard<HierarchicalMutex> guard(high);
+        assert(high.isHeldByCurrentThread());
+    }
+    assert(HierarchicalMutex::heldCount() == 0);
 }
 
 int main()
 {
     test_resource_graph();
+    test_deadlock_cycle();
+    test_find_deadlocks();
+    test_condition_variable_cycle();
+    test_future_cycle();
+    test_snapshot_export();
+    test_bankers_algorithm();
+    test_object_pool();
+    test_transactions();
+    test_hold_budget();
+    test_lock_order();
+    test_lock_ids();
     test_hierarchical_mutex();
 
     std::cout << "All tests passed!\n";
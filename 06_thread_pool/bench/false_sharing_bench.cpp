@@ -0,0 +1,132 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "cache_padded.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * @brief 伪共享基准测试
+ *
+ * 1. 计数器：每个线程递增自己的计数器，比较相邻存放与 CachePadded 存放的耗时
+ * 2. 线程池：大量空任务的吞吐，同时有一个线程不停读取统计信息，
+ *    检查监控读取是否拖慢调度
+ *
+ * 用法：false_sharing_bench [线程数，默认 32] [每线程迭代次数，默认 1000000]
+ * 线程数多于 CPU 核数时差异会被调度开销掩盖，应在核数足够的机器上运行。
+ */
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    double elapsed_ms(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    /**
+     * @brief 每个线程对 counters[i] 执行 iterations 次递增
+     */
+    template <class Counter>
+    double run_counters(std::vector<Counter> &counters, size_t iterations)
+    {
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (auto &counter : counters)
+        {
+            threads.emplace_back([&go, &counter, iterations]()
+                                 {
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < iterations; ++i)
+                {
+                    (*counter).fetch_add(1, std::memory_order_relaxed);
+                } });
+        }
+
+        auto start = Clock::now();
+        go = true;
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        return elapsed_ms(start);
+    }
+
+    /**
+     * @brief 相邻存放的计数器，与 CachePadded 提供相同的解引用接口
+     */
+    struct Packed
+    {
+        std::atomic<uint64_t> value{0};
+        std::atomic<uint64_t> &operator*() { return value; }
+    };
+
+    void bench_counters(size_t threads, size_t iterations)
+    {
+        std::vector<Packed> packed(threads);
+        std::vector<CachePadded<std::atomic<uint64_t>>> padded(threads);
+
+        double packed_ms = run_counters(packed, iterations);
+        double padded_ms = run_counters(padded, iterations);
+
+        std::cout << "Counters (" << threads << " threads x " << iterations << " increments)\n"
+                  << "  packed:       " << packed_ms << " ms\n"
+                  << "  CachePadded:  " << padded_ms << " ms\n"
+                  << "  speedup:      " << packed_ms / padded_ms << "x\n";
+    }
+
+    void bench_pool(size_t threads, size_t tasks)
+    {
+        ThreadPool pool(threads);
+        pool.warm_up();
+
+        std::atomic<bool> stop_monitor{false};
+        std::atomic<uint64_t> snapshots{0};
+        std::thread monitor([&pool, &stop_monitor, &snapshots]()
+                            {
+            while (!stop_monitor)
+            {
+                pool.get_statistics();
+                snapshots++;
+            } });
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            pool.submit(0, std::chrono::milliseconds::max(), []() {});
+        }
+        pool.wait_all();
+        double ms = elapsed_ms(start);
+
+        stop_monitor = true;
+        monitor.join();
+
+        std::cout << "ThreadPool (" << threads << " workers, " << tasks << " empty tasks)\n"
+                  << "  elapsed:      " << ms << " ms\n"
+                  << "  throughput:   " << static_cast<uint64_t>(tasks / (ms / 1000)) << " tasks/s\n"
+                  << "  snapshots:    " << snapshots << " concurrent get_statistics() calls\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    if (threads == 0 || iterations == 0)
+    {
+        std::cerr << "usage: " << argv[0] << " [threads] [iterations]\n";
+        return 1;
+    }
+
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n";
+    bench_counters(threads, iterations);
+    bench_pool(threads, iterations / 10);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief 缓存行大小
+ *
+ * x86-64 和大多数 ARM64 为 64 字节。std::hardware_destructive_interference_size
+ * 的值随编译选项变化（GCC 会为此告警），不适合用于影响对象布局的场合，因此固定取值。
+ */
+constexpr std::size_t cache_line_size = 64;
+
+/**
+ * @brief 独占缓存行的值
+ *
+ * 多个线程频繁写入的变量彼此相邻时，即使访问的是不同变量，也会争用同一缓存行（伪共享）。
+ * 用 CachePadded 包装后，对象按缓存行对齐，大小向上取整为缓存行的整数倍，
+ * 不会与前后的成员共享缓存行。
+ *
+ * @code
+ * CachePadded<std::atomic<uint64_t>> counter{0};
+ * counter->fetch_add(1);
+ * @endcode
+ */
+template <class T>
+struct alignas(cache_line_size) CachePadded
+{
+    T value;
+
+    /**
+     * @brief 用参数原地构造 value
+     *
+     * 显式且只接受能构造 T 的参数，不会与拷贝/移动构造竞争，也不会让任意类型隐式转换为 CachePadded
+     */
+    template <class... Args,
+              class = std::enable_if_t<std::is_constructible_v<T, Args...> &&
+                                       !(sizeof...(Args) == 1 &&
+                                         std::conjunction_v<std::is_same<std::decay_t<Args>, CachePadded>...>)>>
+    constexpr explicit CachePadded(Args &&...args) : value(std::forward<Args>(args)...) {}
+
+    CachePadded(const CachePadded &) = default;
+    CachePadded(CachePadded &&) = default;
+    CachePadded &operator=(const CachePadded &) = default;
+    CachePadded &operator=(CachePadded &&) = default;
+
+    T &operator*() { return value; }
+    const T &operator*() const { return value; }
+    T *operator->() { return &value; }
+    const T *operator->() const { return &value; }
+};
@@ -0,0 +1,265 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <ucontext.h>
+#include "thread_pool.hpp"
+
+class FiberScheduler;
+
+/**
+ * @brief 用户态纤程，由 FiberScheduler 创建和调度
+ */
+class Fiber
+{
+private:
+    friend class FiberScheduler;
+    friend class FiberMutex;
+    friend class FiberConditionVariable;
+
+    FiberScheduler *scheduler;
+    std::function<void()> func;
+    ucontext_t context;
+    ucontext_t *return_context = nullptr; // 当前承载它的工作线程的上下文
+    void *stack = nullptr;
+    bool finished = false;
+    bool yielded = false;
+    std::mutex *handoff = nullptr; // 切换出去之后才释放的锁
+
+    Fiber(FiberScheduler *s, std::function<void()> f) : scheduler(s), func(std::move(f)) {}
+
+    /**
+     * @brief 挂起当前纤程，切回工作线程后才释放 lock
+     *
+     * 唤醒方必须持有同一把锁才能找到并重新调度该纤程，
+     * 因此纤程在完全切换出去之前不会被另一个工作线程恢复
+     */
+    void suspend(std::unique_lock<std::mutex> &lock);
+
+    void switch_out();
+    static void entry();
+};
+
+/**
+ * @brief M:N 纤程调度器：大量纤程复用线程池的工作线程
+ *
+ * 每个纤程拥有独立的小栈（可带保护页），通过 ucontext 在用户态切换：
+ * 1. 就绪的纤程作为一个任务提交到线程池，在任意工作线程上恢复执行
+ * 2. 纤程阻塞在 FiberMutex、FiberConditionVariable 或 FiberChannel 上时让出工作线程，
+ *    不阻塞操作系统线程
+ * 3. 纤程栈按批分配、按需提交物理内存（MAP_NORESERVE），结束后复用
+ *
+ * 每个保护页都会占用独立的内存映射，受 vm.max_map_count（默认 65530）限制，
+ * 开启保护页时同时存在的纤程约为三万个；需要十万级纤程时关闭保护页。
+ *
+ * 纤程内不应调用会阻塞操作系统线程的同步原语，否则会占住工作线程。
+ * 纤程可能在不同的工作线程上恢复，不要跨挂起点使用 thread_local 变量。
+ * FiberScheduler 必须先于线程池析构，析构时等待所有纤程结束。
+ */
+class FiberScheduler
+{
+public:
+    static constexpr size_t default_stack_size = 64 * 1024;
+
+    /**
+     * @param pool 承载纤程的线程池
+     * @param stack_size 每个纤程的栈大小（不含保护页）
+     * @param guard_pages 是否在每个栈底放置不可访问的保护页
+     */
+    explicit FiberScheduler(ThreadPool &pool, size_t stack_size = default_stack_size,
+                            bool guard_pages = true);
+    ~FiberScheduler();
+
+    FiberScheduler(const FiberScheduler &) = delete;
+    FiberScheduler &operator=(const FiberScheduler &) = delete;
+
+    /**
+     * @brief 创建纤程并调度执行
+     *
+     * 纤程函数抛出的异常被捕获并计入 failed()
+     *
+     * @throws std::runtime_error 如果线程池已停止，此时纤程不会创建，栈立即归还
+     */
+    void spawn(std::function<void()> func);
+
+    /**
+     * @brief 等待所有纤程结束，不能在纤程中调用
+     */
+    void wait_all();
+
+    /**
+     * @brief 尚未结束的纤程数
+     */
+    size_t active() const { return active_fibers; }
+
+    /**
+     * @brief 因异常结束的纤程数
+     */
+    size_t failed() const { return failed_fibers; }
+
+    /**
+     * @brief 纤程上下文切换次数
+     */
+    uint64_t switches() const { return context_switches; }
+
+    /**
+     * @brief 让出工作线程，稍后重新调度；不在纤程中时让出操作系统线程
+     */
+    static void yield();
+
+    /**
+     * @brief 当前线程是否正在执行纤程
+     */
+    static bool in_fiber();
+
+private:
+    friend class Fiber;
+    friend class FiberMutex;
+    friend class FiberConditionVariable;
+
+    static Fiber *current();
+    static void set_current(Fiber *fiber);
+
+    void schedule(Fiber *fiber);
+    void resume(Fiber *fiber);
+    void fiber_exited();
+    void *allocate_stack();
+    void release_stack(void *stack);
+
+    ThreadPool &pool;
+    const size_t stack_size;
+    const size_t guard_size;
+
+    std::mutex stacks_mutex;
+    std::vector<std::pair<void *, size_t>> slabs; // 批量映射的栈内存
+    std::vector<void *> free_stacks;
+
+    std::atomic<size_t> active_fibers{0};
+    std::atomic<size_t> failed_fibers{0};
+    std::atomic<uint64_t> context_switches{0};
+    std::mutex done_mutex;
+    std::condition_variable all_done;
+};
+
+/**
+ * @brief 纤程互斥锁：争用时挂起纤程而不是阻塞工作线程
+ *
+ * 解锁时直接把所有权交给等待最久的纤程，满足 Lockable 要求，可配合 std::unique_lock 使用。
+ */
+class FiberMutex
+{
+public:
+    FiberMutex() = default;
+    FiberMutex(const FiberMutex &) = delete;
+    FiberMutex &operator=(const FiberMutex &) = delete;
+
+    /**
+     * @brief 加锁；纤程中争用时挂起，非纤程线程则让出 CPU 自旋重试
+     */
+    void lock();
+    bool try_lock();
+    void unlock();
+
+private:
+    std::mutex guard;
+    bool locked = false;
+    std::deque<Fiber *> waiters;
+};
+
+/**
+ * @brief 纤程条件变量，配合 FiberMutex 使用
+ */
+class FiberConditionVariable
+{
+public:
+    FiberConditionVariable() = default;
+    FiberConditionVariable(const FiberConditionVariable &) = delete;
+    FiberConditionVariable &operator=(const FiberConditionVariable &) = delete;
+
+    /**
+     * @throws std::logic_error 如果不在纤程中调用
+     */
+    void wait(std::unique_lock<FiberMutex> &lock);
+
+    template <class Predicate>
+    void wait(std::unique_lock<FiberMutex> &lock, Predicate pred)
+    {
+        while (!pred())
+        {
+            wait(lock);
+        }
+    }
+
+    void notify_one();
+    void notify_all();
+
+private:
+    std::mutex guard;
+    std::deque<Fiber *> waiters;
+};
+
+/**
+ * @brief 纤程间的有界通道
+ *
+ * 满时 push 挂起发送方，空时 pop 挂起接收方；close() 后 push 失败，
+ * pop 取完剩余元素后返回 std::nullopt
+ */
+template <class T>
+class FiberChannel
+{
+public:
+    explicit FiberChannel(size_t capacity) : capacity(capacity > 0 ? capacity : 1) {}
+
+    /**
+     * @return false 如果通道已关闭
+     */
+    bool push(T value)
+    {
+        std::unique_lock<FiberMutex> lock(mutex);
+        not_full.wait(lock, [this]
+                      { return closed || items.size() < capacity; });
+        if (closed)
+        {
+            return false;
+        }
+        items.push_back(std::move(value));
+        not_empty.notify_one();
+        return true;
+    }
+
+    std::optional<T> pop()
+    {
+        std::unique_lock<FiberMutex> lock(mutex);
+        not_empty.wait(lock, [this]
+                       { return closed || !items.empty(); });
+        if (items.empty())
+        {
+            return std::nullopt;
+        }
+        T value = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return value;
+    }
+
+    void close()
+    {
+        std::unique_lock<FiberMutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    FiberMutex mutex;
+    FiberConditionVariable not_empty;
+    FiberConditionVariable not_full;
+    std::deque<T> items;
+    bool closed = false;
+};
@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "thread_pool.hpp"
+
+/**
+ * @brief 异步文件 I/O 执行器
+ *
+ * 把读写请求交给内核异步完成，完成后的续延任务投递回 CPU 线程池执行，
+ * 因此 I/O 等待不会占用线程池的工作线程：
+ * 1. 优先使用 io_uring：提交线程直接写入 SQ 环，专用完成线程收割 CQ 环
+ * 2. 内核不支持 io_uring（或被容器策略禁止）时，退化为少量专用阻塞线程执行 pread/pwrite
+ * 3. 返回的 TaskFuture 属于 CPU 线程池，工作线程中等待它时会协助执行其它任务
+ * 4. 同时在途的请求数不超过 queue_depth，超出时提交方阻塞
+ *
+ * 续延任务在 I/O 完成后才进入 CPU 线程池的队列，遵循 TaskOptions 中的优先级和租户。
+ * IoExecutor 必须先于它所投递的线程池析构；析构时会等待所有在途请求完成。
+ */
+class IoExecutor
+{
+public:
+    /**
+     * @param pool 执行续延任务的 CPU 线程池
+     * @param queue_depth 同时在途的最大请求数
+     * @param use_io_uring 为 false 时强制使用阻塞线程
+     */
+    explicit IoExecutor(ThreadPool &pool, unsigned queue_depth = 64, bool use_io_uring = true);
+    ~IoExecutor();
+
+    IoExecutor(const IoExecutor &) = delete;
+    IoExecutor &operator=(const IoExecutor &) = delete;
+
+    /**
+     * @brief 是否使用 io_uring（否则为阻塞线程）
+     */
+    bool using_io_uring() const { return ring_fd >= 0; }
+
+    /**
+     * @brief 异步读取，结果在 CPU 线程池中交给续延函数
+     *
+     * 读到文件末尾时返回的数据可能短于 length。
+     *
+     * @param fd 文件描述符
+     * @param length 读取的字节数
+     * @param offset 文件偏移，-1 表示使用并推进文件当前位置
+     * @param continuation 以读到的数据（std::vector<char>）为参数的函数
+     * @param options 续延任务的优先级、标签和租户
+     * @return TaskFuture<> 续延函数的结果；I/O 失败时为 std::system_error
+     */
+    template <class F>
+    auto async_read(int fd, size_t length, off_t offset, F &&continuation,
+                    const ThreadPool::TaskOptions &options = {})
+        -> ThreadPool::TaskFuture<typename std::result_of<F(std::vector<char>)>::type>
+    {
+        auto op = std::make_shared<Operation>(fd, offset, false, std::vector<char>(length));
+        auto deferred = pool.defer(options, [op, continuation = std::forward<F>(continuation)]() mutable
+                                   { return continuation(read_result(*op)); });
+        op->release = std::move(deferred.release);
+        start(op);
+        return std::move(deferred.future);
+    }
+
+    /**
+     * @brief 异步读取，直接返回读到的数据
+     */
+    ThreadPool::TaskFuture<std::vector<char>> async_read(int fd, size_t length, off_t offset);
+
+    /**
+     * @brief 异步写入全部数据，写入的字节数交给续延函数
+     *
+     * @param fd 文件描述符
+     * @param data 要写入的数据，由执行器持有直到写入完成
+     * @param offset 文件偏移，-1 表示使用并推进文件当前位置
+     * @param continuation 以写入字节数（size_t）为参数的函数
+     * @param options 续延任务的优先级、标签和租户
+     */
+    template <class F>
+    auto async_write(int fd, std::vector<char> data, off_t offset, F &&continuation,
+                     const ThreadPool::TaskOptions &options = {})
+        -> ThreadPool::TaskFuture<typename std::result_of<F(size_t)>::type>
+    {
+        auto op = std::make_shared<Operation>(fd, offset, true, std::move(data));
+        auto deferred = pool.defer(options, [op, continuation = std::forward<F>(continuation)]() mutable
+                                   { return continuation(write_result(*op)); });
+        op->release = std::move(deferred.release);
+        start(op);
+        return std::move(deferred.future);
+    }
+
+    /**
+     * @brief 异步写入全部数据，返回写入的字节数
+     */
+    ThreadPool::TaskFuture<size_t> async_write(int fd, std::vector<char> data, off_t offset);
+
+private:
+    /**
+     * @brief 一次读写请求
+     *
+     * 短读/短写时会从已完成的位置继续提交，直到传输完 buffer、遇到文件末尾或出错
+     */
+    struct Operation
+    {
+        int fd;
+        off_t offset;
+        bool write;
+        std::vector<char> buffer;
+        size_t transferred = 0;
+        int error = 0;                 // 失败时的 errno
+        std::function<void()> release; // 把续延任务放入 CPU 线程池
+
+        Operation(int f, off_t off, bool w, std::vector<char> data)
+            : fd(f), offset(off), write(w), buffer(std::move(data)) {}
+    };
+
+    static std::vector<char> read_result(Operation &op);
+    static size_t write_result(Operation &op);
+
+    void start(const std::shared_ptr<Operation> &op);
+    void complete(const std::shared_ptr<Operation> &op);
+    void perform_blocking(Operation &op);
+
+    // io_uring
+    bool setup_ring(unsigned entries);
+    void teardown_ring();
+    void submit_sqe(const std::shared_ptr<Operation> &op);
+    void completion_loop();
+    bool handle_cqe(uint64_t user_data, int32_t result);
+
+    ThreadPool &pool;
+    const unsigned queue_depth;
+
+    // 在途请求数，限制在 queue_depth 以内
+    std::mutex flight_mutex;
+    std::condition_variable flight_condition;
+    unsigned in_flight = 0;
+
+    // io_uring 环，ring_fd < 0 表示未启用
+    int ring_fd = -1;
+    std::mutex submit_mutex; // 保护 SQ 环的写入
+    void *sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    void *cq_ring = nullptr;
+    size_t cq_ring_size = 0;
+    void *sqe_array = nullptr;
+    size_t sqe_array_size = 0;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_index = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    void *cqes = nullptr;
+    std::thread completion_thread;
+
+    // 退化模式下执行阻塞 I/O 的线程
+    std::unique_ptr<ThreadPool> blocking_pool;
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <sys/epoll.h>
+#include "thread_pool.hpp"
+
+/**
+ * @brief 基于 epoll 的事件循环，就绪回调投递到线程池执行
+ *
+ * 一个事件循环线程即可监视成千上万个连接，取代“每连接一个线程”的模式：
+ * 1. 支持水平触发和边沿触发（EPOLLET）
+ * 2. 同一个文件描述符的回调不会并发执行；水平触发的描述符在回调返回后才重新监视，
+ *    边沿触发期间到达的新事件在回调返回后补发，不会丢失
+ * 3. 定时器：一次性或周期性，到期后回调同样投递到线程池
+ * 4. 其它线程注册描述符或定时器时通过 eventfd 唤醒事件循环
+ *
+ * Reactor 必须先于它所投递的线程池析构；析构时会等待已投递的回调执行完毕。
+ */
+class Reactor
+{
+public:
+    using Callback = std::function<void(uint32_t events)>;
+    using TimerId = uint64_t;
+
+    /**
+     * @param pool 执行回调的线程池
+     */
+    explicit Reactor(ThreadPool &pool);
+    ~Reactor();
+
+    Reactor(const Reactor &) = delete;
+    Reactor &operator=(const Reactor &) = delete;
+
+    /**
+     * @brief 监视文件描述符
+     *
+     * @param fd 文件描述符，边沿触发时应设为非阻塞
+     * @param events EPOLLIN、EPOLLOUT 等事件，加上 EPOLLET 表示边沿触发
+     * @param callback 就绪时在线程池中调用，参数为就绪的事件
+     * @param options 回调任务的优先级、标签和租户
+     *
+     * @throws std::system_error 如果 epoll_ctl 失败
+     * @throws std::invalid_argument 如果该描述符已在监视中
+     */
+    void add(int fd, uint32_t events, Callback callback, const ThreadPool::TaskOptions &options = {});
+
+    /**
+     * @brief 修改监视的事件，正在执行回调时在回调返回后生效
+     */
+    void modify(int fd, uint32_t events);
+
+    /**
+     * @brief 停止监视文件描述符
+     *
+     * 返回后不会再为该描述符投递新回调，但已投递的回调可能仍在执行。
+     * 调用者可以随后关闭描述符。
+     *
+     * @return false 如果该描述符未在监视中
+     */
+    bool remove(int fd);
+
+    /**
+     * @brief 添加定时器
+     *
+     * @param delay 首次触发的延迟
+     * @param callback 到期时在线程池中调用
+     * @param interval 大于 0 时周期性触发
+     * @param options 回调任务的优先级、标签和租户
+     * @return TimerId 用于取消定时器
+     */
+    TimerId add_timer(std::chrono::milliseconds delay, std::function<void()> callback,
+                      std::chrono::milliseconds interval = std::chrono::milliseconds(0),
+                      const ThreadPool::TaskOptions &options = {});
+
+    /**
+     * @brief 取消定时器，已投递的回调不受影响
+     *
+     * @return false 如果定时器不存在或一次性定时器已触发
+     */
+    bool cancel_timer(TimerId id);
+
+    /**
+     * @brief 监视中的描述符数量
+     */
+    size_t watched() const;
+
+    /**
+     * @brief 事件循环因 epoll_wait 出错而退出时的错误，正常运行时为空
+     *
+     * 事件循环退出后已注册的回调不会再触发，add()、modify()、add_timer() 抛出 std::system_error。
+     */
+    std::error_code error() const;
+
+private:
+    /**
+     * @brief 一个被监视的描述符
+     */
+    struct Handler
+    {
+        int fd;
+        uint32_t events;
+        Callback callback;
+        ThreadPool::TaskOptions options;
+        bool running = false;  // 回调已投递或正在执行
+        uint32_t pending = 0;  // 回调执行期间到达的边沿触发事件
+        bool removed = false;
+    };
+
+    struct Timer
+    {
+        std::function<void()> callback;
+        std::chrono::milliseconds interval;
+        ThreadPool::TaskOptions options;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    /**
+     * @brief 定时器堆条目，取消的定时器留在堆中，出堆时跳过
+     */
+    struct TimerEntry
+    {
+        std::chrono::steady_clock::time_point deadline;
+        TimerId id;
+
+        bool operator<(const TimerEntry &other) const
+        {
+            return deadline > other.deadline;
+        }
+    };
+
+    static uint32_t registration(uint32_t events);
+
+    void loop();
+    void wakeup();
+    void dispatch(const std::shared_ptr<Handler> &handler, uint32_t events);
+    void run_handler(const std::shared_ptr<Handler> &handler, uint32_t events);
+    void rearm(const std::shared_ptr<Handler> &handler);
+    int next_timeout();
+    void run_expired_timers();
+    void submit(const ThreadPool::TaskOptions &options, std::function<void()> task);
+    void check_running() const;
+
+    ThreadPool &pool;
+    int epoll_fd = -1;
+    int wakeup_fd = -1;
+
+    mutable std::mutex handlers_mutex; // 保护 handlers 及 Handler 的状态
+    std::map<int, std::shared_ptr<Handler>> handlers;
+
+    std::mutex timer_mutex;
+    std::map<TimerId, Timer> timers;
+    std::priority_queue<TimerEntry> timer_queue;
+    TimerId next_timer_id = 1;
+
+    // 已投递但尚未执行完的回调数，析构时等待归零
+    std::mutex callbacks_mutex;
+    std::condition_variable callbacks_done;
+    size_t outstanding_callbacks = 0;
+
+    std::atomic<bool> stopping{false};
+    std::atomic<int> loop_errno{0}; // 事件循环出错退出时的 errno
+    std::thread loop_thread;
+};
@@ -0,0 +1,308 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "thread_pool.hpp"
+
+/**
+ * @brief 把同类小任务合并成批，由用户提供的批处理函数一次处理
+ *
+ * 单个任务的调度开销超过任务本身时（如逐条更新索引项），逐个 submit 得不偿失：
+ * 1. 第一个元素到达后开启一个批次，flush 窗口到期或元素数达到 max_batch 时入队
+ * 2. 批次入队后、开始执行前到达的元素仍会并入该批次（不超过 max_batch），
+ *    线程池越忙，批次越大
+ * 3. 每个元素得到自己的 TaskFuture，批处理完成后就绪；在工作线程中等待时会协助执行
+ * 4. 批处理函数抛出异常时，该批次所有元素的 future 都得到该异常
+ *
+ * @tparam Item 元素类型
+ * @tparam Result 每个元素的结果类型，可以为 void
+ *
+ * 批处理函数的签名为 std::vector<Result>(std::vector<Item> &)，返回与输入等长的结果；
+ * Result 为 void 时为 void(std::vector<Item> &)。
+ * TaskCoalescer 必须先于线程池析构，且不能在该线程池的工作线程中析构；
+ * 析构时提交剩余元素并等待所有批次执行完毕。
+ */
+template <class Item, class Result>
+class TaskCoalescer
+{
+public:
+    using BatchResult = typename std::conditional<std::is_void<Result>::value, void, std::vector<Result>>::type;
+    using BatchFunction = std::function<BatchResult(std::vector<Item> &)>;
+
+    /**
+     * @param pool 执行批处理的线程池
+     * @param batch_function 批处理函数
+     * @param max_batch 每批的最大元素数
+     * @param window 第一个元素到达后最多等待多久入队，为 0 时立即入队
+     * @param options 批处理任务的优先级、标签和租户
+     */
+    TaskCoalescer(ThreadPool &pool, BatchFunction batch_function, size_t max_batch = 256,
+                  std::chrono::microseconds window = std::chrono::microseconds(100),
+                  ThreadPool::TaskOptions options = {})
+        : pool(pool), batch_function(std::move(batch_function)),
+          max_batch(std::max<size_t>(max_batch, 1)), window(window), options(std::move(options))
+    {
+        if (this->window.count() > 0)
+        {
+            flusher = std::thread(&TaskCoalescer::flush_loop, this);
+        }
+    }
+
+    /**
+     * @brief 提交剩余元素并阻塞等待所有批次结束
+     *
+     * 不能在 pool 的工作线程（包括批处理函数）中析构：这里只是阻塞，不会像 TaskFuture 那样协助执行，
+     * 线程池只有一个工作线程或所有工作线程都在析构时，排队的批次没有线程执行，析构永远不会返回。
+     */
+    ~TaskCoalescer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        flush_condition.notify_all();
+        if (flusher.joinable())
+        {
+            flusher.join();
+        }
+
+        flush();
+        std::unique_lock<std::mutex> lock(mutex);
+        batches_done.wait(lock, [this]
+                          { return outstanding_batches == 0; });
+    }
+
+    TaskCoalescer(const TaskCoalescer &) = delete;
+    TaskCoalescer &operator=(const TaskCoalescer &) = delete;
+
+    /**
+     * @brief 提交一个元素
+     * @return TaskFuture<Result> 批处理完成后就绪
+     *
+     * 不会因线程池已停止而抛出：批次入队时线程池已关闭则被放弃（同 ThreadPool::defer），
+     * 返回的 future 以 std::future_error（broken_promise）结束。
+     */
+    ThreadPool::TaskFuture<Result> submit(Item item)
+    {
+        std::promise<Result> promise;
+        std::future<Result> result = promise.get_future();
+        std::shared_ptr<Batch> to_release;
+        ThreadPool::TaskFuture<Result> future;
+        bool opened = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!open)
+            {
+                open = make_batch();
+                opened = true;
+            }
+
+            open->items.push_back(std::move(item));
+            open->promises.push_back(std::move(promise));
+            future = open->task.attach(std::move(result));
+            submitted_items++;
+
+            // 窗口为 0 时立即入队；批次已满时封口，之后的元素进入新批次
+            if ((window.count() == 0 || open->items.size() >= max_batch) && !open->released)
+            {
+                open->released = true;
+                to_release = open;
+            }
+            if (open->items.size() >= max_batch)
+            {
+                open.reset();
+            }
+        }
+
+        if (to_release)
+        {
+            release(*to_release);
+        }
+        else if (opened)
+        {
+            flush_condition.notify_one();
+        }
+        return future;
+    }
+
+    /**
+     * @brief 立即把当前批次放入线程池队列
+     */
+    void flush()
+    {
+        std::shared_ptr<Batch> to_release;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (open && !open->released)
+            {
+                open->released = true;
+                to_release = open;
+            }
+        }
+        if (to_release)
+        {
+            release(*to_release);
+        }
+    }
+
+    /**
+     * @brief 已执行的批次数
+     */
+    size_t batches() const { return executed_batches; }
+
+    /**
+     * @brief 已提交的元素数
+     */
+    size_t items() const { return submitted_items; }
+
+private:
+    struct Batch
+    {
+        std::vector<Item> items;
+        std::vector<std::promise<Result>> promises;
+        ThreadPool::TaskFuture<void> task; // 批处理任务，元素的 future 都依附于它
+        std::function<void()> release;
+        std::chrono::steady_clock::time_point deadline;
+        bool released = false;
+    };
+
+    /**
+     * @brief 创建批次及其延迟入队的任务，调用者持有 mutex
+     */
+    std::shared_ptr<Batch> make_batch()
+    {
+        auto batch = std::make_shared<Batch>();
+        batch->deadline = std::chrono::steady_clock::now() + window;
+
+        // 任务函数销毁时（执行完毕或线程池关闭时被放弃）批次才算结束
+        outstanding_batches++;
+        std::shared_ptr<void> token(nullptr, [this](void *)
+                                    {
+            std::lock_guard<std::mutex> lock(mutex);
+            outstanding_batches--;
+            batches_done.notify_all(); });
+
+        auto deferred = pool.defer(options, [this, batch, token]()
+                                   { run(*batch); });
+        // 只保留任务状态用于 attach，不持有批处理任务自身的 future：
+        // packaged_task 的共享状态里保存着引用批次的任务函数，持有它会形成引用环
+        batch->task = deferred.future.attach(std::future<void>());
+        batch->release = std::move(deferred.release);
+        return batch;
+    }
+
+    /**
+     * @brief 把批次放入线程池队列
+     *
+     * 先取出 release，打破 批次 -> release -> 任务 -> 批次 的引用环；
+     * 剩余的 批次 -> 任务状态 -> 任务函数 -> 批次 在任务执行或被放弃时由线程池打破
+     */
+    static void release(Batch &batch)
+    {
+        auto release = std::move(batch.release);
+        batch.release = nullptr;
+        release();
+    }
+
+    void run(Batch &batch)
+    {
+        std::vector<Item> items;
+        std::vector<std::promise<Result>> promises;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (open.get() == &batch)
+            {
+                open.reset();
+            }
+            items.swap(batch.items);
+            promises.swap(batch.promises);
+        }
+        executed_batches++;
+
+        try
+        {
+            if constexpr (std::is_void<Result>::value)
+            {
+                batch_function(items);
+                for (auto &promise : promises)
+                {
+                    promise.set_value();
+                }
+            }
+            else
+            {
+                std::vector<Result> results = batch_function(items);
+                if (results.size() != promises.size())
+                {
+                    throw std::length_error("TaskCoalescer: batch function returned wrong number of results");
+                }
+                for (size_t i = 0; i < promises.size(); ++i)
+                {
+                    promises[i].set_value(std::move(results[i]));
+                }
+            }
+        }
+        catch (...)
+        {
+            std::exception_ptr error = std::current_exception();
+            for (auto &promise : promises)
+            {
+                promise.set_exception(error);
+            }
+        }
+    }
+
+    void flush_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping)
+        {
+            if (!open || open->released)
+            {
+                flush_condition.wait(lock);
+                continue;
+            }
+
+            // 复制截止时间：等待期间批次可能被封口、执行并释放
+            auto deadline = open->deadline;
+            if (std::chrono::steady_clock::now() < deadline)
+            {
+                flush_condition.wait_until(lock, deadline);
+                continue;
+            }
+
+            std::shared_ptr<Batch> batch = open;
+            batch->released = true;
+            lock.unlock();
+            release(*batch);
+            lock.lock();
+        }
+    }
+
+    ThreadPool &pool;
+    BatchFunction batch_function;
+    const size_t max_batch;
+    const std::chrono::microseconds window;
+    const ThreadPool::TaskOptions options;
+
+    std::mutex mutex;
+    std::shared_ptr<Batch> open; // 仍可并入新元素的批次
+    size_t outstanding_batches = 0;
+    std::condition_variable batches_done;
+    std::condition_variable flush_condition;
+    std::thread flusher;
+    bool stopping = false;
+
+    std::atomic<size_t> executed_batches{0};
+    std::atomic<size_t> submitted_items{0};
+};
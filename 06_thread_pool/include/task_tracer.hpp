@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 线程池任务执行轨迹记录器
+ *
+ * 记录任务的提交、出队、开始和结束事件，导出为 Chrome trace-event JSON，
+ * 可直接在 Perfetto（ui.perfetto.dev）或 chrome://tracing 中打开：
+ * - 每个工作线程写入自己的缓冲区，记录路径无锁
+ * - 非工作线程（提交者）共享一个缓冲区，通过原子操作预留槽位
+ * - 缓冲区写满后丢弃新事件并计数，已记录的前缀保持完整
+ */
+class TaskTracer
+{
+public:
+    enum class EventType : uint8_t
+    {
+        Submit,
+        Dequeue,
+        Start,
+        End
+    };
+
+    static constexpr size_t max_label_length = 47;
+    static constexpr int external_thread = -1; // 非工作线程的 worker id
+
+    struct Event
+    {
+        EventType type;
+        int worker_id;
+        int priority;
+        uint64_t task_id;
+        int64_t timestamp_ns; // 相对于 TaskTracer 创建时刻
+        char label[max_label_length + 1];
+    };
+
+    /**
+     * @brief 单个线程的事件缓冲区
+     *
+     * 写入者先通过 fetch_add 预留槽位，写完后设置槽位的 ready 标志；
+     * 导出时只读取 ready 的槽位，因此无需加锁也不会读到写了一半的事件
+     */
+    class Buffer
+    {
+    private:
+        struct Slot
+        {
+            Event event;
+            std::atomic<bool> ready{false};
+        };
+
+        std::unique_ptr<Slot[]> slots;
+        size_t capacity;
+        std::atomic<size_t> reserved{0};
+        std::atomic<uint64_t> dropped{0};
+
+    public:
+        const int worker_id;
+
+        Buffer(int worker, size_t cap);
+
+        void push(const Event &event);
+        void collect(std::vector<Event> &out) const;
+        uint64_t dropped_events() const { return dropped; }
+    };
+
+    /**
+     * @param events_per_buffer 每个缓冲区可容纳的事件数
+     */
+    explicit TaskTracer(size_t events_per_buffer = 1 << 14);
+
+    /**
+     * @brief 获取工作线程的缓冲区，不存在时创建
+     *
+     * 仅在工作线程启动时调用一次，结果由调用者缓存
+     */
+    Buffer *buffer_for_worker(int worker_id);
+
+    /**
+     * @brief 记录一个事件
+     * @param buffer 当前线程的缓冲区，nullptr 表示非工作线程
+     */
+    void record(Buffer *buffer, EventType type, uint64_t task_id,
+                int priority, const std::string &label);
+
+    /**
+     * @brief 导出 Chrome trace-event JSON
+     */
+    void export_chrome_trace(std::ostream &out) const;
+
+    /**
+     * @brief 被丢弃的事件总数
+     */
+    uint64_t dropped_events() const;
+
+private:
+    const size_t events_per_buffer;
+    const std::chrono::steady_clock::time_point origin;
+
+    mutable std::mutex buffers_mutex; // 仅保护缓冲区注册和导出时的遍历
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    Buffer external; // 非工作线程共享的缓冲区
+};
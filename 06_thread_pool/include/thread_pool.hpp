@@ -0,0 +1,736 @@
+#pragma once
+#include <thread>
+#include <queue>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <ostream>
+#include <map>
+#include <initializer_list>
+#include <cstdint>
+#include <pthread.h>
+#include "cache_padded.hpp"
+#include "task_tracer.hpp"
+
+/**
+ * @brief 增强版线程池实现
+ *
+ * 特性：
+ * 1. 支持任务优先级
+ * 2. 支持任务取消
+ * 3. 支持任务超时
+ * 4. 支持异常处理
+ * 5. 支持优雅关闭
+ * 6. 提供详细的运行时统计
+ * 7. 工作线程等待本池任务时会协助执行队列中的任务，避免自死锁
+ * 8. 可选的任务执行轨迹记录，导出为 Chrome/Perfetto trace
+ * 9. 按任务和标签统计线程 CPU 时间与墙钟时间
+ * 10. 支持限时关闭：排空、仅完成运行中任务、立即停止
+ * 11. 支持运行时调整线程数、暂停和恢复调度
+ * 12. 多租户加权公平调度：租户之间按权重差额轮询，可限制租户并发数
+ * 13. 卡死任务看门狗：任务运行超过预算时回调，并附带工作线程的调用栈
+ * 14. 可选的延迟启动：工作线程按需创建，可预先触碰并锁定线程栈
+ * 15. 支持延迟入队的任务（defer），供 IoExecutor 等外部事件源投递续延
+ * 16. 一个任务可以完成多个 future（attach），供 TaskCoalescer 合并小任务
+ * 17. 优先级继承：等待任务结果时被等待的任务（及其等待链）提升到等待者的优先级
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @brief 单个任务的执行时间
+     *
+     * cpu_time 为执行线程的 CPU 时间（CLOCK_THREAD_CPUTIME_ID），不含协助等待期间
+     * 内联执行的其它任务；wall_time 为开始到结束的墙钟时间。
+     * 两者差距大说明任务主要阻塞在锁或 I/O 上。
+     */
+    struct TaskTiming
+    {
+        std::chrono::nanoseconds cpu_time{0};
+        std::chrono::nanoseconds wall_time{0};
+    };
+
+    /**
+     * @brief 按标签汇总的执行时间
+     */
+    struct LabelTiming
+    {
+        uint64_t tasks = 0;
+        std::chrono::nanoseconds cpu_time{0};
+        std::chrono::nanoseconds wall_time{0};
+    };
+
+    /**
+     * @brief 看门狗上报的卡死任务
+     */
+    struct StuckTaskReport
+    {
+        int worker_id;
+        uint64_t task_id;
+        std::string label;
+        std::string tenant;
+        std::chrono::milliseconds elapsed;
+        std::vector<std::string> stack; // 工作线程的调用栈（已符号化），采集失败时为空
+    };
+
+private:
+    struct Tenant;
+
+    /**
+     * @brief 任务共享状态，由队列条目和返回给调用者的 TaskFuture 共同持有
+     */
+    struct TaskState
+    {
+        std::function<void()> func;                     // 任务函数
+        uint64_t id;                                    // 任务编号
+        int priority;                                   // 优先级
+        std::string label;                              // 任务标签，用于轨迹记录
+        std::chrono::steady_clock::time_point deadline; // 任务截止时间
+        std::atomic<bool> claimed{false};               // 是否已被某个线程认领执行
+        std::atomic<bool> cancelled{false};             // 取消标志
+        std::atomic<bool> done{false};                  // 是否已处理完毕（执行、超时或取消）
+        std::atomic<int> waiters{0};                    // 正在协助等待该任务的工作线程数
+        std::atomic<int> effective_priority;            // 继承等待者优先级后的实际优先级
+        std::shared_ptr<TaskState> waiting_on;          // 执行该任务的线程正在等待的任务，受 queue_mutex 保护
+        TaskTiming timing;                              // 执行时间，done 之后可读
+        Tenant *tenant = nullptr;                       // 所属租户，入队前设置
+
+        TaskState(std::function<void()> f, uint64_t task_id, int p, std::string l,
+                  std::chrono::milliseconds timeout)
+            : func(std::move(f)), id(task_id), priority(p), label(std::move(l)),
+              deadline(deadline_after(timeout)), effective_priority(p) {}
+    };
+
+    /**
+     * @brief 队列条目，支持优先级
+     *
+     * 任务可能被等待者直接认领执行，此时队列中的条目会在出队时被跳过
+     */
+    struct Task
+    {
+        std::shared_ptr<TaskState> state;
+        int priority; // 优先级（数字越大优先级越高）
+
+        // 优先级比较，用于优先队列排序
+        bool operator<(const Task &other) const
+        {
+            return priority < other.priority;
+        }
+    };
+
+    /**
+     * @brief 租户（任务类别），拥有独立的优先队列
+     *
+     * 租户之间使用差额轮询（DRR）：轮到某个租户时发放 weight 个配额，
+     * 每分派一个任务消耗一个配额，因此长期吞吐量与权重成正比，
+     * 单个租户提交大量高优先级任务也只能占用自己的份额。
+     * 租户一旦创建就不会删除，TaskState 可以安全地保存其指针。
+     */
+    struct Tenant
+    {
+        std::string name;
+        std::priority_queue<Task> queue; // 租户内按优先级排序（受 queue_mutex 保护）
+        unsigned deficit = 0;            // DRR 剩余配额（受 queue_mutex 保护）
+
+        std::atomic<unsigned> weight{1};        // 每轮配额
+        std::atomic<size_t> max_concurrency{0}; // 最大并发数，0 表示不限
+
+        // 以下计数每个任务都会写，与只读为主的配额分开，放在独立的缓存行
+        alignas(cache_line_size) std::atomic<size_t> pending{0}; // 尚未被认领的任务数
+        std::atomic<size_t> running{0};         // 已分派、尚未处理完的任务数
+        std::atomic<uint64_t> executed{0};      // 已处理完的任务数
+    };
+
+    /**
+     * @brief 任务计数块，独占缓存行，避免各工作线程更新计数时互相使缓存行失效
+     *
+     * 每个块同一时刻只有一个写者（所属工作线程，或持有 external_counters_mutex 的外部线程），
+     * 写入前后各递增一次 sequence（seqlock）：读者看到奇数或前后不一致时重读，
+     * 从而得到块内一致的快照。一个任务从认领到结束的计数都记在同一个块中。
+     */
+    struct alignas(cache_line_size) CounterBlock
+    {
+        std::atomic<uint64_t> sequence{0};  // 奇数表示正在写入
+        std::atomic<uint64_t> claimed{0};   // 已认领（含被放弃）的任务数
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint64_t> timeout{0};
+        std::atomic<uint64_t> cancelled{0};
+        CounterBlock *next = nullptr; // 计数块链表，只增不减，发布后不再修改
+    };
+
+    /**
+     * @brief 工作线程的运行状态，供看门狗读取
+     *
+     * 与线程槽位绑定，同一 id 的新线程复用；创建后直到线程池析构才释放
+     */
+    struct WorkerContext
+    {
+        std::mutex mutex;                                // 保护以下字段，仅在任务开始和结束时短暂加锁
+        pthread_t native{};                              // 当前线程句柄，用于发送采集调用栈的信号
+        std::shared_ptr<TaskState> task;                 // 正在执行的任务，空闲时为空
+        std::chrono::steady_clock::time_point started{}; // 当前任务开始时间
+        uint64_t reported_task = UINT64_MAX;             // 已上报过的任务编号，每个任务只上报一次
+        bool capturing = false;                          // 看门狗正在向该线程发信号采集调用栈，线程退出前需等待
+        std::condition_variable capture_done;            // capturing 清除时通知
+        CounterBlock counters;                           // 该槽位线程的任务计数，旧线程 join 后由新线程接着写
+    };
+
+    /**
+     * @brief 工作线程槽位，下标即 worker id
+     */
+    struct Worker
+    {
+        std::thread thread;
+        std::unique_ptr<WorkerContext> context;
+        bool retired = false; // 已因缩容退出，等待 join（受 queue_mutex 保护）
+    };
+
+    /*
+     * 成员布局按访问模式分组，避免无关的写入使调度路径读取的缓存行失效：
+     * 1. 只读为主：停止标志和启动选项，每次取任务都会读，几乎不写
+     * 2. 队列锁及其保护的状态：同一时刻只有持锁者写，放在一起，持锁者一次取得整组
+     * 3. 每个任务都会写的原子计数：各自独占缓存行（CachePadded）
+     * 4. 按任务结果分类的计数：写在各工作线程自己的 CounterBlock 中
+     * 其余成员（统计、看门狗、轨迹）只在低频路径上访问。
+     */
+
+    // 1. 只读为主
+    std::atomic<bool> stop{false};      // 停止标志
+    std::atomic<bool> interrupt{false}; // 请求运行中的任务尽快退出（协作式）
+    const bool lazy_start = false;
+    const size_t stack_prefault_bytes = 0;
+    const bool lock_stack = false;
+
+    // 2. 队列锁及其保护的状态，从新的缓存行开始
+    alignas(cache_line_size) mutable std::mutex queue_mutex; // 队列互斥锁
+    size_t target_workers = 0;         // 目标线程数，id 不小于该值的线程空闲时退出（受 queue_mutex 保护）
+    size_t idle_workers = 0;           // 空闲（含刚创建尚未取任务）的工作线程数（受 queue_mutex 保护）
+    bool paused = false;               // 暂停调度，仍接受提交（受 queue_mutex 保护）
+    size_t tenant_cursor = 0;              // 当前轮到的租户（受 queue_mutex 保护）
+    size_t queued_entries = 0;             // 所有租户队列中的条目数，含已认领的残留条目（受 queue_mutex 保护）
+    std::vector<Tenant *> tenant_order;    // DRR 轮询顺序（受 queue_mutex 保护）
+    std::vector<Worker> workers;       // 工作线程集合（受 queue_mutex 保护）
+    std::map<std::string, Tenant> tenants; // 租户表，key 为租户名（修改需同时持有 queue_mutex 和 tenant_mutex）
+    std::condition_variable condition;  // 条件变量
+    std::condition_variable drained;    // 关闭时通知队列已取空
+
+    // 3. 高频写入的计数，各自独占缓存行
+    CachePadded<std::atomic<int>> active_threads{0};       // 活跃线程计数，每个任务开始和结束时写
+    CachePadded<std::atomic<uint64_t>> submitted_tasks{0}; // 已入队的任务数，只在持有 queue_mutex 时递增
+    CachePadded<std::atomic<uint64_t>> next_task_id{0};    // 任务编号生成器，每次提交时写
+
+    // 低频访问的同步和统计
+    mutable std::mutex tenant_mutex; // 统计读取租户表时使用，避免触碰 queue_mutex
+    std::mutex shutdown_mutex;       // 保证关闭流程只执行一次
+    bool shut_down = false;
+    std::atomic<uint64_t> priority_boosts{0}; // 优先级继承次数
+
+    // 4. 任务计数：工作线程写各自 WorkerContext 中的块，非工作线程共用 external_counters
+    CounterBlock external_counters;
+    std::mutex external_counters_mutex;                       // 串行化 external_counters 的写者
+    std::atomic<CounterBlock *> counter_blocks{&external_counters}; // 所有计数块的链表头，读取时无需加锁
+
+    /**
+     * @brief 某一时刻的任务计数，满足 submitted = pending + running + 各结束状态之和
+     */
+    struct Counts
+    {
+        uint64_t submitted = 0;
+        uint64_t claimed = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t timeout = 0;
+        uint64_t cancelled = 0;
+    };
+
+    // 按标签汇总的执行时间（标签为空的任务汇总在空字符串下）
+    mutable std::mutex timing_mutex;
+    std::map<std::string, LabelTiming> label_timings;
+
+    // 看门狗
+    std::mutex watchdog_mutex;
+    std::condition_variable watchdog_condition;
+    std::thread watchdog;
+    uint64_t watchdog_generation = 0; // 每次启用或停止时加一，看门狗线程发现变化即退出（受 watchdog_mutex 保护）
+    std::atomic<uint64_t> stuck_tasks{0};
+
+    // 轨迹记录：tracer 一旦创建就保留到线程池析构，active_tracer 为空表示未启用
+    std::mutex tracer_mutex;
+    std::unique_ptr<TaskTracer> tracer;
+    std::atomic<TaskTracer *> active_tracer{nullptr};
+
+    // 当前线程所属的线程池（非工作线程为 nullptr）
+    inline static thread_local ThreadPool *current_pool = nullptr;
+    // 当前线程的任务嵌套深度，用于在协助执行时不重复计入活跃线程
+    inline static thread_local int task_depth = 0;
+    // 当前工作线程的编号（非工作线程为 -1）
+    inline static thread_local int current_worker_id = TaskTracer::external_thread;
+    // 当前工作线程的轨迹缓冲区，首次记录时获取
+    inline static thread_local TaskTracer::Buffer *trace_buffer = nullptr;
+    // 当前任务执行期间内联执行的子任务所消耗的 CPU 时间
+    inline static thread_local std::chrono::nanoseconds nested_cpu_time{0};
+    // 当前工作线程的运行状态
+    inline static thread_local WorkerContext *current_context = nullptr;
+    // 当前线程正在执行的任务（任意线程池），等待其它任务时把优先级传给被等待者
+    inline static thread_local TaskState *current_task = nullptr;
+
+    static std::chrono::nanoseconds thread_cpu_now();
+
+    static std::chrono::steady_clock::time_point deadline_after(std::chrono::milliseconds timeout);
+
+    void worker_thread(int worker_id);
+    bool spawn_worker();
+    void enqueue(const std::shared_ptr<TaskState> &state, const std::string &tenant, bool deferred);
+    Tenant &tenant_for(const std::string &name);
+    bool has_capacity(const Tenant &tenant) const;
+    bool can_dispatch() const;
+    std::shared_ptr<TaskState> pop_task();
+    void release_slot(Tenant &tenant);
+    void trace(TaskTracer::EventType type, const TaskState &state);
+    void add_counts(std::initializer_list<std::atomic<uint64_t> CounterBlock::*> counters);
+    Counts collect_counts() const;
+    bool try_claim(TaskState &state);
+    void execute(const std::shared_ptr<TaskState> &state);
+    void finish(TaskState &state);
+    size_t abandon_pending();
+    void stop_watchdog();
+    void check_stuck_workers(std::chrono::milliseconds budget,
+                             const std::function<void(const StuckTaskReport &)> &callback);
+    bool run_one_pending();
+    void help_until_done(const std::shared_ptr<TaskState> &target);
+    void boost(std::shared_ptr<TaskState> target, int priority);
+
+public:
+    /**
+     * @brief submit 返回的任务句柄
+     *
+     * 接口与 std::future 一致。当调用 get()/wait() 的线程本身是同一线程池的工作线程时，
+     * 它不会阻塞，而是优先内联执行所等待的任务，否则执行队列中的其它任务，直到结果就绪。
+     * 这样递归分治的任务即使占满所有工作线程也不会死锁。
+     */
+    template <class T>
+    class TaskFuture
+    {
+    private:
+        std::future<T> future;
+        std::shared_ptr<TaskState> state;
+        ThreadPool *pool = nullptr;
+
+    public:
+        TaskFuture() = default;
+        TaskFuture(std::future<T> f, std::shared_ptr<TaskState> s, ThreadPool *p)
+            : future(std::move(f)), state(std::move(s)), pool(p) {}
+
+        bool valid() const { return future.valid(); }
+
+        void wait()
+        {
+            if (pool != nullptr && current_pool == pool)
+            {
+                pool->help_until_done(state);
+            }
+            else if (pool != nullptr && current_task != nullptr)
+            {
+                // 其它线程池的任务在等待：被等待的任务继承其优先级
+                pool->boost(state, current_task->effective_priority);
+            }
+            future.wait();
+        }
+
+        /**
+         * @brief 获取任务结果；工作线程中调用时会协助执行任务
+         */
+        T get()
+        {
+            wait();
+            return future.get();
+        }
+
+        /**
+         * @brief 限时等待，不协助执行任务
+         */
+        template <class Rep, class Period>
+        std::future_status wait_for(const std::chrono::duration<Rep, Period> &timeout) const
+        {
+            return future.wait_for(timeout);
+        }
+
+        /**
+         * @brief 获取任务的执行时间，会等待任务处理完毕
+         *
+         * 超时或被取消的任务返回全零
+         */
+        TaskTiming timing()
+        {
+            // get() 之后 future 已失效，此时任务必然已执行完毕
+            if (future.valid())
+            {
+                wait();
+            }
+            while (!state->done)
+            {
+                // 结果就绪到记录完时间之间只有很短的窗口
+                std::this_thread::yield();
+            }
+            return state->timing;
+        }
+
+        /**
+         * @brief 请求取消任务，仅对尚未开始执行的任务有效
+         */
+        void cancel()
+        {
+            if (state)
+            {
+                state->cancelled = true;
+            }
+        }
+
+        /**
+         * @brief 把尚未开始的任务提升到至少 priority（优先级继承）
+         *
+         * 在本池或其它线程池的任务中等待时会自动继承等待者的优先级，
+         * 普通线程等待高优先级结果前可以显式调用。若该任务正在执行并等待其它任务，
+         * 提升会沿等待链传递下去。
+         */
+        void boost(int priority)
+        {
+            if (pool != nullptr && state)
+            {
+                pool->boost(state, priority);
+            }
+        }
+
+        /**
+         * @brief 任务当前的实际优先级（含继承）
+         */
+        int priority() const
+        {
+            return state ? state->effective_priority.load() : 0;
+        }
+
+        /**
+         * @brief 创建由同一任务完成的另一个 future
+         *
+         * 用于一个任务产生多个结果（如批处理）：在工作线程中等待返回的 future
+         * 同样会协助执行该任务。对返回的 future 调用 cancel() 会取消整个任务。
+         */
+        template <class U>
+        TaskFuture<U> attach(std::future<U> other) const
+        {
+            return TaskFuture<U>(std::move(other), state, pool);
+        }
+    };
+
+    /**
+     * @brief 构造函数
+     * @param threads 工作线程数量，默认为硬件支持的并发线程数
+     */
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+
+    /**
+     * @brief 启动选项
+     */
+    struct Options
+    {
+        size_t threads = std::thread::hardware_concurrency(); // 工作线程数量上限
+        bool lazy_start = false;                              // 提交任务且没有空闲线程时才创建线程
+        size_t stack_prefault_bytes = 0;                      // 线程启动时预先触碰的栈大小，0 表示不触碰
+        bool lock_stack = false;                              // 用 mlock 锁定预先触碰的栈页
+    };
+
+    /**
+     * @brief 按选项构造
+     *
+     * 延迟启动时构造函数不创建任何线程，短生命周期的程序只为实际用到的线程付出启动开销；
+     * 需要时可调用 warm_up() 提前创建全部线程
+     */
+    explicit ThreadPool(const Options &options);
+
+    /**
+     * @brief 析构函数
+     *
+     * 如果尚未调用 shutdown()，以 Drain 模式关闭，确保所有任务完成后再关闭线程池
+     */
+    ~ThreadPool();
+
+    /**
+     * @brief 关闭模式
+     */
+    enum class ShutdownMode
+    {
+        Drain,         // 继续执行队列中的任务，直到队列为空或到达期限
+        CancelPending, // 只等待运行中的任务，队列中的任务立即取消
+        Immediate      // 取消队列中的任务，并请求运行中的任务尽快退出
+    };
+
+    /**
+     * @brief 任务提交选项
+     */
+    struct TaskOptions
+    {
+        int priority = 0;                                                     // 任务优先级
+        std::chrono::milliseconds timeout = std::chrono::milliseconds::max(); // 任务超时时间
+        std::string label;                                                    // 任务标签
+        std::string tenant;                                                   // 所属租户，未配置的租户权重为 1
+    };
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+private:
+    /**
+     * @brief 创建任务包装器和对应的 TaskFuture，不入队
+     */
+    template <class F, class... Args>
+    auto make_task(const TaskOptions &options, F &&f, Args &&...args)
+        -> std::pair<TaskFuture<typename std::result_of<F(Args...)>::type>, std::shared_ptr<TaskState>>
+    {
+        using return_type = typename std::result_of<F(Args...)>::type;
+
+        // 创建任务包装器
+        auto task = std::make_shared<std::packaged_task<return_type()>>(
+            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+        std::future<return_type> res = task->get_future();
+        auto state = std::make_shared<TaskState>([task]()
+                                                 { (*task)(); },
+                                                 (*next_task_id)++, options.priority,
+                                                 options.label, options.timeout);
+        return {TaskFuture<return_type>(std::move(res), state, this), state};
+    }
+
+public:
+    /**
+     * @brief 提交任务到线程池
+     *
+     * @param options 任务优先级、超时时间和标签
+     * @param f 任务函数
+     * @param args 任务函数参数
+     * @return TaskFuture<> 用于获取任务结果
+     *
+     * @throws std::runtime_error 如果线程池已停止
+     */
+    template <class F, class... Args>
+    auto submit(const TaskOptions &options, F &&f, Args &&...args)
+        -> TaskFuture<typename std::result_of<F(Args...)>::type>
+    {
+        auto [future, state] = make_task(options, std::forward<F>(f), std::forward<Args>(args)...);
+        enqueue(state, options.tenant, false);
+        return std::move(future);
+    }
+
+    /**
+     * @brief 延迟入队的任务
+     */
+    template <class T>
+    struct DeferredTask
+    {
+        TaskFuture<T> future;          // 任务句柄，可以立即交给调用者
+        std::function<void()> release; // 调用后任务才进入队列，只能调用一次
+    };
+
+    /**
+     * @brief 创建任务但暂不入队，直到调用 release()
+     *
+     * 用于由外部事件（如 I/O 完成）触发的续延任务：调用者立即得到 TaskFuture，
+     * 在工作线程中等待它时会协助执行其它任务，但不会提前内联执行该任务。
+     * 线程池关闭后才 release 的任务会被放弃，其 future 以 broken_promise 结束。
+     */
+    template <class F, class... Args>
+    auto defer(const TaskOptions &options, F &&f, Args &&...args)
+        -> DeferredTask<typename std::result_of<F(Args...)>::type>
+    {
+        auto [future, state] = make_task(options, std::forward<F>(f), std::forward<Args>(args)...);
+
+        // 标记为已认领，入队前任何线程都无法执行它
+        state->claimed = true;
+        std::string tenant = options.tenant;
+        return {std::move(future), [this, state = std::move(state), tenant = std::move(tenant)]()
+                { enqueue(state, tenant, true); }};
+    }
+
+    /**
+     * @brief 提交任务到线程池
+     *
+     * @param priority 任务优先级
+     * @param timeout 任务超时时间
+     * @param f 任务函数
+     * @param args 任务函数参数
+     * @return TaskFuture<> 用于获取任务结果
+     *
+     * @throws std::runtime_error 如果线程池已停止
+     */
+    template <class F, class... Args>
+    auto submit(int priority, std::chrono::milliseconds timeout, F &&f, Args &&...args)
+        -> TaskFuture<typename std::result_of<F(Args...)>::type>
+    {
+        TaskOptions options;
+        options.priority = priority;
+        options.timeout = timeout;
+        return submit(options, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief 获取待处理任务数量，不加锁
+     */
+    size_t get_pending_tasks() const;
+
+    /**
+     * @brief 单个租户的统计信息
+     */
+    struct TenantStatistics
+    {
+        unsigned weight;
+        size_t max_concurrency;
+        size_t pending_tasks;
+        size_t running_tasks;
+        uint64_t executed_tasks;
+    };
+
+    /**
+     * @brief 获取线程池统计信息
+     *
+     * 任务计数取自一致的快照，不触碰队列锁，监控频繁读取也不会拖慢调度
+     */
+    struct Statistics
+    {
+        int active_threads;
+        uint64_t completed_tasks;
+        uint64_t failed_tasks;
+        uint64_t timeout_tasks;
+        uint64_t cancelled_tasks;
+        size_t pending_tasks;
+        size_t running_tasks;     // 已认领、尚未结束的任务数
+        uint64_t submitted_tasks; // 等于 pending + running + completed + failed + timeout + cancelled
+        uint64_t stuck_tasks;
+        uint64_t priority_boosts; // 因等待而提升任务优先级的次数
+        std::chrono::nanoseconds total_cpu_time;
+        std::chrono::nanoseconds total_wall_time;
+        std::map<std::string, LabelTiming> per_label;
+        std::map<std::string, TenantStatistics> per_tenant;
+    };
+
+    Statistics get_statistics() const;
+
+    /**
+     * @brief 等待所有任务完成
+     * @param timeout 最大等待时间，默认无限等待
+     * @return 是否在超时前完成所有任务
+     */
+    bool wait_all(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+    /**
+     * @brief 关闭线程池
+     *
+     * 调用后不再接受新任务。被放弃的任务计入 cancelled_tasks，
+     * 其 future 以 std::future_error(broken_promise) 结束。
+     * 运行中的任务无法被抢占，函数总会等待它们结束后再返回；
+     * Immediate 模式下任务可通过 stop_requested() 协作式地提前退出。
+     *
+     * @param mode 关闭模式
+     * @param deadline Drain 模式下排空队列的最长时间，到期后剩余任务被放弃
+     * @return 被放弃（未执行）的任务数；重复调用返回 0
+     */
+    size_t shutdown(ShutdownMode mode = ShutdownMode::Drain,
+                    std::chrono::milliseconds deadline = std::chrono::milliseconds::max());
+
+    /**
+     * @brief 配置租户的调度权重和并发上限
+     *
+     * @param name 租户名，与 TaskOptions::tenant 对应
+     * @param weight 每轮可分派的任务数，至少为 1
+     * @param max_concurrency 同时运行的任务上限，0 表示不限
+     */
+    void configure_tenant(const std::string &name, unsigned weight, size_t max_concurrency = 0);
+
+    /**
+     * @brief 调整工作线程数量，不丢失队列中的任务
+     *
+     * 扩容立即创建新线程；缩容时多余的线程在完成当前任务后退出，
+     * 已退出的线程在下次 resize() 或 shutdown() 时回收
+     *
+     * @throws std::runtime_error 如果线程池已关闭
+     */
+    void resize(size_t threads);
+
+    /**
+     * @brief 目标工作线程数量
+     */
+    size_t size() const;
+
+    /**
+     * @brief 当前已创建且未退出的工作线程数量
+     */
+    size_t live_threads() const;
+
+    /**
+     * @brief 立即创建所有尚未启动的工作线程
+     */
+    void warm_up();
+
+    /**
+     * @brief 暂停调度：运行中的任务继续执行，新提交的任务只入队不执行
+     */
+    void pause();
+
+    /**
+     * @brief 恢复调度
+     */
+    void resume();
+
+    bool is_paused() const;
+
+    /**
+     * @brief 当前线程正在执行的任务所属线程池是否请求立即停止
+     *
+     * 长任务可以周期性检查此标志以配合 ShutdownMode::Immediate
+     */
+    static bool stop_requested();
+
+    /**
+     * @brief 启用看门狗
+     *
+     * 后台线程定期检查每个工作线程当前任务的运行时间，超过预算时向该线程发送信号，
+     * 在信号处理函数中用 backtrace() 采集调用栈，然后在看门狗线程中调用回调。
+     * 每个任务最多上报一次，上报次数计入 Statistics::stuck_tasks。
+     * 符号名需要可执行文件导出符号（-rdynamic）。重复调用会替换预算和回调。
+     *
+     * @param budget 单个任务的运行时间预算
+     * @param callback 在看门狗线程中调用，不应长时间阻塞
+     * @throws std::runtime_error 如果线程池已关闭
+     */
+    void enable_watchdog(std::chrono::milliseconds budget,
+                         std::function<void(const StuckTaskReport &)> callback);
+
+    /**
+     * @brief 停止看门狗
+     */
+    void disable_watchdog();
+
+    /**
+     * @brief 开始记录任务提交、出队、开始和结束事件
+     * @param events_per_buffer 每个线程缓冲区的容量，仅首次启用时生效
+     */
+    void enable_tracing(size_t events_per_buffer = 1 << 14);
+
+    /**
+     * @brief 停止记录事件，已记录的事件保留
+     */
+    void disable_tracing();
+
+    /**
+     * @brief 导出 Chrome trace-event JSON，可在 Perfetto 中打开
+     * @return 从未启用过轨迹记录时返回 false
+     */
+    bool export_trace(std::ostream &out);
+};
@@ -0,0 +1,321 @@
+#include "fiber.hpp"
+#include <stdexcept>
+#include <system_error>
+#include <cerrno>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+    thread_local Fiber *current_fiber = nullptr;
+
+    // 每次映射的栈数，减少 mmap 调用和内存映射数量
+    constexpr size_t stacks_per_slab = 64;
+
+    size_t page_size()
+    {
+        return static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    }
+}
+
+// 纤程可能在另一个线程上恢复，thread_local 的地址不能跨切换缓存，
+// 因此只通过不内联的函数访问
+__attribute__((noinline)) Fiber *FiberScheduler::current()
+{
+    return current_fiber;
+}
+
+__attribute__((noinline)) void FiberScheduler::set_current(Fiber *fiber)
+{
+    current_fiber = fiber;
+}
+
+bool FiberScheduler::in_fiber()
+{
+    return current() != nullptr;
+}
+
+void Fiber::switch_out()
+{
+    scheduler->context_switches++;
+    swapcontext(&context, return_context);
+}
+
+void Fiber::suspend(std::unique_lock<std::mutex> &lock)
+{
+    handoff = lock.release();
+    switch_out();
+}
+
+void Fiber::entry()
+{
+    Fiber *fiber = FiberScheduler::current();
+    try
+    {
+        fiber->func();
+    }
+    catch (...)
+    {
+        fiber->scheduler->failed_fibers++;
+    }
+    fiber->func = nullptr;
+    fiber->finished = true;
+
+    // 切回后不会再恢复，栈由工作线程释放
+    fiber = FiberScheduler::current();
+    fiber->switch_out();
+}
+
+FiberScheduler::FiberScheduler(ThreadPool &pool, size_t stack_size, bool guard_pages)
+    : pool(pool),
+      stack_size((stack_size + page_size() - 1) & ~(page_size() - 1)),
+      guard_size(guard_pages ? page_size() : 0) {}
+
+FiberScheduler::~FiberScheduler()
+{
+    wait_all();
+    for (auto &[slab, length] : slabs)
+    {
+        ::munmap(slab, length);
+    }
+}
+
+void *FiberScheduler::allocate_stack()
+{
+    std::lock_guard<std::mutex> lock(stacks_mutex);
+    if (free_stacks.empty())
+    {
+        size_t stride = stack_size + guard_size;
+        size_t length = stride * stacks_per_slab;
+        void *slab = ::mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if (slab == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), "FiberScheduler: mmap failed");
+        }
+        slabs.emplace_back(slab, length);
+
+        // 栈向下增长，最低的一页作为保护页，溢出时立即触发 SIGSEGV
+        for (size_t i = 0; i < stacks_per_slab; ++i)
+        {
+            char *stack = static_cast<char *>(slab) + i * stride;
+            if (guard_size > 0)
+            {
+                ::mprotect(stack, guard_size, PROT_NONE);
+            }
+            free_stacks.push_back(stack);
+        }
+    }
+
+    void *stack = free_stacks.back();
+    free_stacks.pop_back();
+    return stack;
+}
+
+void FiberScheduler::release_stack(void *stack)
+{
+    std::lock_guard<std::mutex> lock(stacks_mutex);
+    free_stacks.push_back(stack);
+}
+
+void FiberScheduler::spawn(std::function<void()> func)
+{
+    auto fiber = std::unique_ptr<Fiber>(new Fiber(this, std::move(func)));
+    fiber->stack = allocate_stack();
+
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = static_cast<char *>(fiber->stack) + guard_size;
+    fiber->context.uc_stack.ss_size = stack_size;
+    fiber->context.uc_link = nullptr;
+    makecontext(&fiber->context, &Fiber::entry, 0);
+
+    active_fibers++;
+    try
+    {
+        schedule(fiber.get());
+    }
+    catch (...)
+    {
+        // 线程池已停止，纤程从未运行：归还栈，不计入活动纤程
+        release_stack(fiber->stack);
+        fiber_exited();
+        throw;
+    }
+    fiber.release();
+}
+
+void FiberScheduler::schedule(Fiber *fiber)
+{
+    ThreadPool::TaskOptions options;
+    options.label = "fiber";
+    pool.submit(options, [this, fiber]()
+                { resume(fiber); });
+}
+
+void FiberScheduler::resume(Fiber *fiber)
+{
+    ucontext_t worker_context;
+    Fiber *previous = current();
+
+    fiber->return_context = &worker_context;
+    set_current(fiber);
+    context_switches++;
+    swapcontext(&worker_context, &fiber->context);
+    set_current(previous);
+
+    if (fiber->finished)
+    {
+        release_stack(fiber->stack);
+        delete fiber;
+        fiber_exited();
+        return;
+    }
+
+    if (fiber->handoff != nullptr)
+    {
+        // 纤程已完全切换出去，唤醒方现在才能拿到它
+        std::mutex *handoff = fiber->handoff;
+        fiber->handoff = nullptr;
+        handoff->unlock();
+        return;
+    }
+
+    if (fiber->yielded)
+    {
+        fiber->yielded = false;
+        schedule(fiber);
+    }
+}
+
+void FiberScheduler::fiber_exited()
+{
+    if (--active_fibers == 0)
+    {
+        // 持锁通知，wait_all() 返回后调度器可能立即析构
+        std::lock_guard<std::mutex> lock(done_mutex);
+        all_done.notify_all();
+    }
+}
+
+void FiberScheduler::wait_all()
+{
+    if (in_fiber())
+    {
+        throw std::logic_error("FiberScheduler: wait_all() called from a fiber");
+    }
+    std::unique_lock<std::mutex> lock(done_mutex);
+    all_done.wait(lock, [this]
+                  { return active_fibers == 0; });
+}
+
+void FiberScheduler::yield()
+{
+    Fiber *fiber = current();
+    if (fiber == nullptr)
+    {
+        std::this_thread::yield();
+        return;
+    }
+    fiber->yielded = true;
+    fiber->switch_out();
+}
+
+void FiberMutex::lock()
+{
+    std::unique_lock<std::mutex> lock(guard);
+    if (!locked)
+    {
+        locked = true;
+        return;
+    }
+
+    Fiber *fiber = FiberScheduler::current();
+    if (fiber == nullptr)
+    {
+        // 非纤程线程无法挂起，只能等锁空闲时抢占
+        lock.unlock();
+        while (!try_lock())
+        {
+            std::this_thread::yield();
+        }
+        return;
+    }
+
+    // unlock() 直接把所有权交给我们，恢复时已持有锁
+    waiters.push_back(fiber);
+    fiber->suspend(lock);
+}
+
+bool FiberMutex::try_lock()
+{
+    std::lock_guard<std::mutex> lock(guard);
+    if (locked)
+    {
+        return false;
+    }
+    locked = true;
+    return true;
+}
+
+void FiberMutex::unlock()
+{
+    Fiber *next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        if (waiters.empty())
+        {
+            locked = false;
+            return;
+        }
+        next = waiters.front();
+        waiters.pop_front();
+    }
+    next->scheduler->schedule(next);
+}
+
+void FiberConditionVariable::wait(std::unique_lock<FiberMutex> &lock)
+{
+    Fiber *fiber = FiberScheduler::current();
+    if (fiber == nullptr)
+    {
+        throw std::logic_error("FiberConditionVariable: wait() called outside a fiber");
+    }
+
+    {
+        std::unique_lock<std::mutex> waiters_lock(guard);
+        waiters.push_back(fiber);
+
+        // 先登记再释放用户锁，通知方必须拿到 guard 才能唤醒，不会丢失通知
+        lock.unlock();
+        fiber->suspend(waiters_lock);
+    }
+    lock.lock();
+}
+
+void FiberConditionVariable::notify_one()
+{
+    Fiber *next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        if (waiters.empty())
+        {
+            return;
+        }
+        next = waiters.front();
+        waiters.pop_front();
+    }
+    next->scheduler->schedule(next);
+}
+
+void FiberConditionVariable::notify_all()
+{
+    std::deque<Fiber *> woken;
+    {
+        std::lock_guard<std::mutex> lock(guard);
+        woken.swap(waiters);
+    }
+    for (Fiber *fiber : woken)
+    {
+        fiber->scheduler->schedule(fiber);
+    }
+}
@@ -0,0 +1,421 @@
+#include "io_executor.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    // 系统未提供 liburing，直接通过系统调用使用 io_uring
+    int io_uring_setup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                                          flags, nullptr, 0));
+    }
+
+    int io_uring_register(int fd, unsigned opcode, void *arg, unsigned count)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    // 内核是否支持指定的操作码
+    bool supports_op(int fd, unsigned op)
+    {
+        constexpr unsigned probe_ops = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+        auto *probe = reinterpret_cast<io_uring_probe *>(storage.data());
+        if (io_uring_register(fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+        {
+            return false;
+        }
+        return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+
+    // 退化模式下的阻塞线程数
+    constexpr unsigned max_blocking_threads = 4;
+
+    // 单次提交的最大字节数，更大的请求按短读/短写分多次完成
+    constexpr size_t max_chunk = size_t{1} << 30;
+
+    // 完成线程的退出信号
+    constexpr uint64_t stop_token = 0;
+}
+
+IoExecutor::IoExecutor(ThreadPool &pool, unsigned queue_depth, bool use_io_uring)
+    : pool(pool), queue_depth(std::max(queue_depth, 1u))
+{
+    if (use_io_uring && setup_ring(this->queue_depth))
+    {
+        completion_thread = std::thread(&IoExecutor::completion_loop, this);
+    }
+    else
+    {
+        blocking_pool = std::make_unique<ThreadPool>(std::min(this->queue_depth, max_blocking_threads));
+    }
+}
+
+IoExecutor::~IoExecutor()
+{
+    {
+        std::unique_lock<std::mutex> lock(flight_mutex);
+        flight_condition.wait(lock, [this]
+                              { return in_flight == 0; });
+    }
+
+    if (using_io_uring())
+    {
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex);
+            unsigned tail = *sq_tail;
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe &sqe = static_cast<io_uring_sqe *>(sqe_array)[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_NOP;
+            sqe.user_data = stop_token;
+            sq_index[index] = index;
+            __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+            while (io_uring_enter(ring_fd, 1, 0, 0) < 0 && errno == EINTR)
+            {
+            }
+        }
+        completion_thread.join();
+        teardown_ring();
+    }
+}
+
+bool IoExecutor::setup_ring(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = io_uring_setup(entries, &params);
+    if (fd < 0)
+    {
+        return false;
+    }
+    ring_fd = fd;
+
+    if (!supports_op(fd, IORING_OP_READ) || !supports_op(fd, IORING_OP_WRITE))
+    {
+        teardown_ring();
+        return false;
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap)
+    {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED)
+    {
+        sq_ring = nullptr;
+        teardown_ring();
+        return false;
+    }
+
+    if (single_mmap)
+    {
+        cq_ring = sq_ring;
+    }
+    else
+    {
+        cq_ring = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED)
+        {
+            cq_ring = nullptr;
+            teardown_ring();
+            return false;
+        }
+    }
+
+    sqe_array_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqe_array = ::mmap(nullptr, sqe_array_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       fd, IORING_OFF_SQES);
+    if (sqe_array == MAP_FAILED)
+    {
+        sqe_array = nullptr;
+        teardown_ring();
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sq_ring);
+    char *cq = static_cast<char *>(cq_ring);
+    sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_index = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+void IoExecutor::teardown_ring()
+{
+    if (sqe_array != nullptr)
+    {
+        ::munmap(sqe_array, sqe_array_size);
+        sqe_array = nullptr;
+    }
+    if (cq_ring != nullptr && cq_ring != sq_ring)
+    {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    cq_ring = nullptr;
+    if (sq_ring != nullptr)
+    {
+        ::munmap(sq_ring, sq_ring_size);
+        sq_ring = nullptr;
+    }
+    if (ring_fd >= 0)
+    {
+        ::close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+ThreadPool::TaskFuture<std::vector<char>> IoExecutor::async_read(int fd, size_t length, off_t offset)
+{
+    return async_read(fd, length, offset, [](std::vector<char> data)
+                      { return data; });
+}
+
+ThreadPool::TaskFuture<size_t> IoExecutor::async_write(int fd, std::vector<char> data, off_t offset)
+{
+    return async_write(fd, std::move(data), offset, [](size_t written)
+                       { return written; });
+}
+
+std::vector<char> IoExecutor::read_result(Operation &op)
+{
+    if (op.error != 0)
+    {
+        throw std::system_error(op.error, std::generic_category(), "IoExecutor: read failed");
+    }
+    op.buffer.resize(op.transferred);
+    return std::move(op.buffer);
+}
+
+size_t IoExecutor::write_result(Operation &op)
+{
+    if (op.error != 0)
+    {
+        throw std::system_error(op.error, std::generic_category(), "IoExecutor: write failed");
+    }
+    return op.transferred;
+}
+
+void IoExecutor::start(const std::shared_ptr<Operation> &op)
+{
+    {
+        std::unique_lock<std::mutex> lock(flight_mutex);
+        flight_condition.wait(lock, [this]
+                              { return in_flight < queue_depth; });
+        in_flight++;
+    }
+
+    try
+    {
+        if (using_io_uring())
+        {
+            submit_sqe(op);
+        }
+        else
+        {
+            blocking_pool->submit(0, std::chrono::milliseconds::max(), [this, op]()
+                                  {
+                perform_blocking(*op);
+                complete(op); });
+        }
+    }
+    catch (...)
+    {
+        // 打破 op -> release -> 任务 -> op 的引用环
+        op->release = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(flight_mutex);
+            in_flight--;
+        }
+        flight_condition.notify_all();
+        throw;
+    }
+}
+
+void IoExecutor::complete(const std::shared_ptr<Operation> &op)
+{
+    // 先取出 release，续延任务执行完后 op 就不再被自身间接引用
+    auto release = std::move(op->release);
+    op->release = nullptr;
+    release();
+
+    // 持锁通知，析构函数可能在等待最后一个请求
+    std::lock_guard<std::mutex> lock(flight_mutex);
+    in_flight--;
+    flight_condition.notify_all();
+}
+
+void IoExecutor::perform_blocking(Operation &op)
+{
+    while (op.transferred < op.buffer.size())
+    {
+        char *data = op.buffer.data() + op.transferred;
+        size_t remaining = op.buffer.size() - op.transferred;
+        off_t position = op.offset + static_cast<off_t>(op.transferred);
+
+        ssize_t n;
+        if (op.write)
+        {
+            n = op.offset < 0 ? ::write(op.fd, data, remaining) : ::pwrite(op.fd, data, remaining, position);
+        }
+        else
+        {
+            n = op.offset < 0 ? ::read(op.fd, data, remaining) : ::pread(op.fd, data, remaining, position);
+        }
+
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            op.error = errno;
+            return;
+        }
+        if (n == 0)
+        {
+            return;
+        }
+        op.transferred += static_cast<size_t>(n);
+    }
+}
+
+void IoExecutor::submit_sqe(const std::shared_ptr<Operation> &op)
+{
+    // user_data 持有 op 的一个引用，由完成线程释放
+    auto holder = std::make_unique<std::shared_ptr<Operation>>(op);
+    size_t remaining = std::min(op->buffer.size() - op->transferred, max_chunk);
+
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe &sqe = static_cast<io_uring_sqe *>(sqe_array)[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = op->write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe.fd = op->fd;
+    sqe.off = op->offset < 0 ? static_cast<uint64_t>(-1)
+                             : static_cast<uint64_t>(op->offset) + op->transferred;
+    sqe.addr = reinterpret_cast<uint64_t>(op->buffer.data() + op->transferred);
+    sqe.len = static_cast<uint32_t>(remaining);
+    sqe.user_data = reinterpret_cast<uint64_t>(holder.get());
+    sq_index[index] = index;
+
+    // 在途请求数不超过环的容量，SQ 不会溢出
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    int result;
+    while ((result = io_uring_enter(ring_fd, 1, 0, 0)) < 0 && errno == EINTR)
+    {
+    }
+    if (result < 0)
+    {
+        // 条目仍在 SQ 中，回退 tail 以撤销提交
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+        throw std::system_error(errno, std::generic_category(), "IoExecutor: io_uring_enter failed");
+    }
+    holder.release();
+}
+
+void IoExecutor::completion_loop()
+{
+    bool running = true;
+    std::chrono::milliseconds backoff(0);
+    while (running)
+    {
+        if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+        {
+            // 等待失败（如 ENOMEM、EBUSY）时退避后重试而不是空转；
+            // 在途操作只能经完成队列归还，因此不能直接退出，已到达的完成事件照常处理
+            if (backoff.count() == 0)
+            {
+                std::cerr << "IoExecutor: io_uring_enter failed: " << std::strerror(errno) << std::endl;
+            }
+            backoff = std::min(std::max(backoff * 2, std::chrono::milliseconds(1)), std::chrono::milliseconds(100));
+            std::this_thread::sleep_for(backoff);
+        }
+        else
+        {
+            backoff = std::chrono::milliseconds(0);
+        }
+
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            const io_uring_cqe &cqe = static_cast<io_uring_cqe *>(cqes)[head & *cq_mask];
+            uint64_t user_data = cqe.user_data;
+            int32_t result = cqe.res;
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+
+            if (!handle_cqe(user_data, result))
+            {
+                running = false;
+            }
+        }
+    }
+}
+
+bool IoExecutor::handle_cqe(uint64_t user_data, int32_t result)
+{
+    if (user_data == stop_token)
+    {
+        return false;
+    }
+
+    std::unique_ptr<std::shared_ptr<Operation>> holder(reinterpret_cast<std::shared_ptr<Operation> *>(user_data));
+    std::shared_ptr<Operation> op = std::move(*holder);
+
+    try
+    {
+        if (result == -EINTR || result == -EAGAIN)
+        {
+            submit_sqe(op);
+            return true;
+        }
+        if (result < 0)
+        {
+            op->error = -result;
+        }
+        else
+        {
+            op->transferred += static_cast<size_t>(result);
+            // 短读/短写：从已完成的位置继续
+            if (result > 0 && op->transferred < op->buffer.size())
+            {
+                submit_sqe(op);
+                return true;
+            }
+        }
+    }
+    catch (const std::system_error &e)
+    {
+        op->error = e.code().value();
+    }
+
+    complete(op);
+    return true;
+}
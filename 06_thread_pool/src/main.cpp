@@ -1,273 +1,18 @@
 #include <iostream>
+#include <algorithm>
 #include <thread>
-#include <queue>
-#include <functional>
-#include <future>
-#include <mutex>
-#include <condition_variable>
 #include <vector>
 #include <chrono>
-#include <atomic>
-#include <exception>
-#include <memory>
-
-/**
- * @brief 增强版线程池实现
- *
- * 特性：
- * 1. 支持任务优先级
- * 2. 支持任务取消
- * 3. 支持任务超时
- * 4. 支持异常处理
- * 5. 支持优雅关闭
- * 6. 提供详细的运行时统计
- */
-class ThreadPool
-{
-private:
-    /**
-     * @brief 任务包装器，支持优先级和取消功能
-     */
-    struct Task
-    {
-        std::function<void()> func;                     // 任务函数
-        int priority;                                   // 优先级（数字越大优先级越高）
-        std::chrono::steady_clock::time_point deadline; // 任务截止时间
-        bool cancelled{false};                          // 取消标志
-
-        // 构造函数，设置任务的优先级和超时时间
-        Task(std::function<void()> f, int p = 0,
-             std::chrono::milliseconds timeout = std::chrono::milliseconds::max())
-            : func(std::move(f)), priority(p), deadline(std::chrono::steady_clock::now() + timeout) {}
-
-        // 优先级比较，用于优先队列排序
-        bool operator<(const Task &other) const
-        {
-            return priority < other.priority;
-        }
-    };
-
-    // 线程池状态和同步相关成员
-    std::vector<std::thread> workers;  // 工作线程集合
-    std::priority_queue<Task> tasks;   // 任务优先队列
-    mutable std::mutex queue_mutex;    // 队列互斥锁
-    std::condition_variable condition; // 条件变量
-    std::atomic<bool> stop{false};     // 停止标志
-
-    // 统计信息
-    std::atomic<int> active_threads{0};       // 活跃线程计数
-    std::atomic<uint64_t> completed_tasks{0}; // 已完成任务计数
-    std::atomic<uint64_t> failed_tasks{0};    // 失败任务计数
-    std::atomic<uint64_t> timeout_tasks{0};   // 超时任务计数
-    std::atomic<uint64_t> cancelled_tasks{0}; // 取消任务计数
-
-    /**
-     * @brief 工作线程的主循环函数
-     *
-     * 工作线程不断从任务队列中获取任务并执行，直到线程池停止
-     * 包含了任务超时检查、取消检查和异常处理
-     */
-    void worker_thread()
-    {
-        while (true)
-        {
-            std::function<void()> task;
-            bool has_timeout = false;
-            bool is_cancelled = false;
-
-            // 获取任务
-            {
-                std::unique_lock<std::mutex> lock(queue_mutex);
-
-                // 等待直到有任务或被通知停止
-                condition.wait(lock, [this]
-                               { return stop || !tasks.empty(); });
-
-                // 如果线程池停止且没有待处理任务，则退出
-                if (stop && tasks.empty())
-                {
-                    return;
-                }
-
-                // 检查任务是否超时或已取消
-                if (!tasks.empty())
-                {
-                    auto now = std::chrono::steady_clock::now();
-                    const Task &top_task = tasks.top();
-
-                    if (top_task.deadline < now)
-                    {
-                        has_timeout = true;
-                        timeout_tasks++;
-                    }
-                    else if (top_task.cancelled)
-                    {
-                        is_cancelled = true;
-                        cancelled_tasks++;
-                    }
-                    else
-                    {
-                        task = std::move(top_task.func);
-                    }
-                    tasks.pop();
-                }
-            }
-
-            // 如果任务有效（未超时且未取消），则执行任务
-            if (task && !has_timeout && !is_cancelled)
-            {
-                active_threads++;
-
-                try
-                {
-                    task();
-                    completed_tasks++;
-                }
-                catch (const std::exception &e)
-                {
-                    std::cerr << "Task exception: " << e.what() << std::endl;
-                    failed_tasks++;
-                }
-                catch (...)
-                {
-                    std::cerr << "Unknown task exception" << std::endl;
-                    failed_tasks++;
-                }
-
-                active_threads--;
-            }
-        }
-    }
-
-public:
-    /**
-     * @brief 构造函数
-     * @param threads 工作线程数量，默认为硬件支持的并发线程数
-     */
-    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency())
-        : stop(false)
-    {
-        for (size_t i = 0; i < threads; ++i)
-        {
-            workers.emplace_back([this]
-                                 { worker_thread(); });
-        }
-    }
-
-    /**
-     * @brief 析构函数
-     *
-     * 确保所有任务完成后再关闭线程池
-     */
-    ~ThreadPool()
-    {
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            stop = true;
-        }
-
-        condition.notify_all();
-        for (std::thread &worker : workers)
-        {
-            if (worker.joinable())
-            {
-                worker.join();
-            }
-        }
-    }
-
-    /**
-     * @brief 提交任务到线程池
-     *
-     * @param priority 任务优先级
-     * @param timeout 任务超时时间
-     * @param f 任务函数
-     * @param args 任务函数参数
-     * @return std::future<> 用于获取任务结果
-     *
-     * @throws std::runtime_error 如果线程池已停止
-     */
-    template <class F, class... Args>
-    auto submit(int priority, std::chrono::milliseconds timeout, F &&f, Args &&...args)
-        -> std::future<typename std::result_of<F(Args...)>::type>
-    {
-        using return_type = typename std::result_of<F(Args...)>::type;
-
-        // 创建任务包装器
-        auto task = std::make_shared<std::packaged_task<return_type()>>(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-
-        std::future<return_type> res = task->get_future();
-
-        // 将任务添加到队列
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-
-            if (stop)
-            {
-                throw std::runtime_error("ThreadPool: submitting on a stopped pool");
-            }
-
-            tasks.emplace([task]()
-                          { (*task)(); }, priority, timeout);
-        }
-
-        condition.notify_one();
-        return res;
-    }
-
-    /**
-     * @brief 获取待处理任务数量
-     */
-    size_t get_pending_tasks() const
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        return tasks.size();
-    }
-
-    /**
-     * @brief 获取线程池统计信息
-     */
-    struct Statistics
-    {
-        int active_threads;
-        uint64_t completed_tasks;
-        uint64_t failed_tasks;
-        uint64_t timeout_tasks;
-        uint64_t cancelled_tasks;
-        size_t pending_tasks;
-    };
-
-    Statistics get_statistics() const
-    {
-        return Statistics{
-            active_threads,
-            completed_tasks,
-            failed_tasks,
-            timeout_tasks,
-            cancelled_tasks,
-            get_pending_tasks()};
-    }
-
-    /**
-     * @brief 等待所有任务完成
-     * @param timeout 最大等待时间，默认无限等待
-     * @return 是否在超时前完成所有任务
-     */
-    bool wait_all(std::chrono::milliseconds timeout = std::chrono::milliseconds::max())
-    {
-        auto start = std::chrono::steady_clock::now();
-        while (get_pending_tasks() > 0 || active_threads > 0)
-        {
-            if (std::chrono::steady_clock::now() - start > timeout)
-            {
-                return false;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
-        return true;
-    }
-};
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include "thread_pool.hpp"
+#include "io_executor.hpp"
+#include "reactor.hpp"
+#include "fiber.hpp"
+#include "task_coalescer.hpp"
+#include <sys/socket.h>
 
 /**
  * @brief 测试用的计算任务
@@ -295,20 +40,63 @@ long long compute_task(int id, int complexity)
 void print_pool_status(const ThreadPool::Statistics &stats)
 {
     std::cout << "\nThread Pool Status:"
+              << "\nSubmitted tasks: " << stats.submitted_tasks
               << "\nPending tasks: " << stats.pending_tasks
+              << "\nRunning tasks: " << stats.running_tasks
               << "\nActive threads: " << stats.active_threads
               << "\nCompleted tasks: " << stats.completed_tasks
               << "\nFailed tasks: " << stats.failed_tasks
               << "\nTimeout tasks: " << stats.timeout_tasks
               << "\nCancelled tasks: " << stats.cancelled_tasks
+              << "\nStuck tasks: " << stats.stuck_tasks
+              << "\nCPU time: " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.total_cpu_time).count() << "ms"
+              << "\nWall time: " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.total_wall_time).count() << "ms"
               << std::endl;
 }
 
+/**
+ * @brief 递归分治求和，任务在工作线程中等待自己提交的子任务
+ *
+ * 递归深度超过工作线程数时，若等待方阻塞在 future 上就会占满线程池而死锁；
+ * TaskFuture::get() 会在等待期间协助执行子任务
+ */
+long long parallel_sum(ThreadPool &pool, const std::vector<int> &data, size_t begin, size_t end)
+{
+    if (end - begin <= 1000)
+    {
+        long long sum = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    auto left = pool.submit(0, std::chrono::milliseconds::max(),
+                            parallel_sum, std::ref(pool), std::cref(data), begin, mid);
+    long long right = parallel_sum(pool, data, mid, end);
+    return left.get() + right;
+}
+
 int main()
 {
     // 创建线程池
     ThreadPool pool(4);
-    std::vector<std::future<long long>> results;
+    std::vector<ThreadPool::TaskFuture<long long>> results;
+
+    // 记录任务执行轨迹，结束后导出供 Perfetto 查看
+    pool.enable_tracing();
+
+    // 看门狗：任务运行超过 2 秒时打印其调用栈
+    pool.enable_watchdog(std::chrono::milliseconds(2000), [](const ThreadPool::StuckTaskReport &report)
+                         {
+        std::cerr << "Stuck task " << report.task_id << " (" << report.label << ") on worker "
+                  << report.worker_id << " for " << report.elapsed.count() << "ms\n";
+        for (const auto &frame : report.stack)
+        {
+            std::cerr << "    " << frame << "\n";
+        } });
 
     // 提交任务
     std::cout << "Submitting tasks...\n";
@@ -318,10 +106,13 @@ int main()
         int complexity = rand() % 5 + 1;
 
         // 设置任务超时时间为5秒
-        auto timeout = std::chrono::milliseconds(5000);
+        ThreadPool::TaskOptions options;
+        options.priority = priority;
+        options.timeout = std::chrono::milliseconds(5000);
+        options.label = "compute " + std::to_string(i);
 
         results.emplace_back(
-            pool.submit(priority, timeout, compute_task, i, complexity));
+            pool.submit(options, compute_task, i, complexity));
 
         std::cout << "Submitted task " << i
                   << " with priority " << priority
@@ -331,9 +122,12 @@ int main()
     // 监控线程池状态
     std::thread monitor([&pool]()
                         {
-        while (pool.get_statistics().pending_tasks > 0 || 
-               pool.get_statistics().active_threads > 0) {
-            print_pool_status(pool.get_statistics());
+        while (true) {
+            auto stats = pool.get_statistics();
+            if (stats.pending_tasks == 0 && stats.running_tasks == 0) {
+                break;
+            }
+            print_pool_status(stats);
             std::this_thread::sleep_for(std::chrono::seconds(1));
         } });
 
@@ -345,6 +139,13 @@ int main()
         {
             std::cout << "Task " << i << " result: "
                       << results[i].get() << std::endl;
+
+            auto timing = results[i].timing();
+            std::cout << "Task " << i << " cpu "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(timing.cpu_time).count()
+                      << "us, wall "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(timing.wall_time).count()
+                      << "us" << std::endl;
         }
         catch (const std::exception &e)
         {
@@ -359,5 +160,127 @@ int main()
     std::cout << "\nFinal Statistics:\n";
     print_pool_status(final_stats);
 
+    // 限时关闭：5 秒内排空队列，超时的任务被放弃
+    size_t abandoned = pool.shutdown(ThreadPool::ShutdownMode::Drain, std::chrono::milliseconds(5000));
+    std::cout << "Abandoned tasks on shutdown: " << abandoned << std::endl;
+
+    std::ofstream trace_file("thread_pool_trace.json");
+    if (pool.export_trace(trace_file))
+    {
+        std::cout << "Trace written to thread_pool_trace.json" << std::endl;
+    }
+
+    // 递归分治：2 个工作线程执行深度远大于 2 的递归任务
+    {
+        ThreadPool small_pool(2);
+        std::vector<int> data(100000, 1);
+        auto total = small_pool.submit(0, std::chrono::milliseconds::max(),
+                                       parallel_sum, std::ref(small_pool), std::cref(data),
+                                       size_t{0}, data.size());
+        std::cout << "\nParallel sum: " << total.get() << std::endl;
+    }
+
+    // 异步文件 I/O：等待 I/O 不占用工作线程，完成后续延在线程池中执行
+    {
+        ThreadPool io_pool(2);
+        IoExecutor io(io_pool);
+        char path[] = "/tmp/thread_demo_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd >= 0)
+        {
+            unlink(path);
+            std::string text = "hello from io_uring";
+            io.async_write(fd, std::vector<char>(text.begin(), text.end()), 0).get();
+            auto words = io.async_read(fd, text.size(), 0, [](std::vector<char> data)
+                                       { return std::count(data.begin(), data.end(), ' ') + 1; });
+            std::cout << "\nI/O backend: " << (io.using_io_uring() ? "io_uring" : "threads")
+                      << ", words read: " << words.get() << std::endl;
+            close(fd);
+        }
+    }
+
+    // 事件循环：socketpair 可读时在线程池中回显，定时器 50ms 后关闭连接
+    {
+        ThreadPool net_pool(2);
+        Reactor reactor(net_pool);
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0)
+        {
+            int server = sv[1];
+            reactor.add(server, EPOLLIN | EPOLLET, [server](uint32_t)
+                        {
+                char buffer[256];
+                ssize_t n;
+                while ((n = read(server, buffer, sizeof(buffer))) > 0)
+                {
+                    ssize_t written = write(server, buffer, static_cast<size_t>(n));
+                    (void)written;
+                } });
+
+            std::promise<void> closed;
+            reactor.add_timer(std::chrono::milliseconds(50), [&]()
+                              {
+                reactor.remove(server);
+                closed.set_value(); });
+
+            std::string message = "echo";
+            ssize_t sent = write(sv[0], message.data(), message.size());
+            (void)sent;
+            closed.get_future().wait();
+
+            char reply[16] = {};
+            ssize_t n = read(sv[0], reply, sizeof(reply) - 1);
+            std::cout << "Reactor echoed: " << (n > 0 ? reply : "(nothing)") << std::endl;
+            close(sv[0]);
+            close(sv[1]);
+        }
+    }
+
+    // 纤程：一万个逻辑任务通过通道汇总结果，只占用两个工作线程
+    {
+        ThreadPool fiber_pool(2);
+        FiberScheduler scheduler(fiber_pool, 16 * 1024);
+        FiberChannel<int> results(64);
+        long long fiber_sum = 0;
+        for (int i = 1; i <= 10000; ++i)
+        {
+            scheduler.spawn([&results, i]()
+                            { results.push(i); });
+        }
+        scheduler.spawn([&results, &fiber_sum]()
+                        {
+            for (int i = 0; i < 10000; ++i)
+            {
+                fiber_sum += *results.pop();
+            } });
+        scheduler.wait_all();
+        std::cout << "Fiber sum: " << fiber_sum << " (" << scheduler.switches()
+                  << " context switches)" << std::endl;
+    }
+
+    // 小任务合并：一万次索引更新合并成少量批处理任务
+    {
+        ThreadPool batch_pool(2);
+        std::vector<int> index(10000, 0);
+        TaskCoalescer<int, void> updater(batch_pool, [&index](std::vector<int> &entries)
+                                         {
+            for (int entry : entries)
+            {
+                index[entry]++;
+            } });
+
+        std::vector<ThreadPool::TaskFuture<void>> updates;
+        for (int i = 0; i < 10000; ++i)
+        {
+            updates.push_back(updater.submit(i));
+        }
+        for (auto &update : updates)
+        {
+            update.get();
+        }
+        std::cout << "Coalesced " << updater.items() << " updates into "
+                  << updater.batches() << " batches" << std::endl;
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "reactor.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr int max_events = 64;
+
+    std::system_error errno_error(const char *what)
+    {
+        return std::system_error(errno, std::generic_category(), what);
+    }
+}
+
+Reactor::Reactor(ThreadPool &pool) : pool(pool)
+{
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        throw errno_error("Reactor: epoll_create1 failed");
+    }
+
+    wakeup_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd < 0)
+    {
+        ::close(epoll_fd);
+        throw errno_error("Reactor: eventfd failed");
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event) < 0)
+    {
+        ::close(wakeup_fd);
+        ::close(epoll_fd);
+        throw errno_error("Reactor: epoll_ctl failed");
+    }
+
+    loop_thread = std::thread(&Reactor::loop, this);
+}
+
+Reactor::~Reactor()
+{
+    stopping = true;
+    wakeup();
+    loop_thread.join();
+
+    // 事件循环停止后不会有新的投递，只剩执行中的回调（及其补发）
+    {
+        std::unique_lock<std::mutex> lock(callbacks_mutex);
+        callbacks_done.wait(lock, [this]
+                            { return outstanding_callbacks == 0; });
+    }
+
+    ::close(wakeup_fd);
+    ::close(epoll_fd);
+}
+
+uint32_t Reactor::registration(uint32_t events)
+{
+    // 水平触发时用 EPOLLONESHOT，回调返回前不会重复报告同一就绪状态
+    return (events & EPOLLET) != 0 ? events : events | EPOLLONESHOT;
+}
+
+void Reactor::add(int fd, uint32_t events, Callback callback, const ThreadPool::TaskOptions &options)
+{
+    auto handler = std::make_shared<Handler>();
+    handler->fd = fd;
+    handler->events = events;
+    handler->callback = std::move(callback);
+    handler->options = options;
+
+    check_running();
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    if (handlers.count(fd) != 0)
+    {
+        throw std::invalid_argument("Reactor: file descriptor already watched");
+    }
+
+    epoll_event event{};
+    event.events = registration(events);
+    event.data.fd = fd;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        throw errno_error("Reactor: epoll_ctl failed");
+    }
+    handlers.emplace(fd, std::move(handler));
+}
+
+void Reactor::modify(int fd, uint32_t events)
+{
+    check_running();
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = handlers.find(fd);
+    if (it == handlers.end())
+    {
+        throw std::invalid_argument("Reactor: file descriptor not watched");
+    }
+
+    Handler &handler = *it->second;
+    handler.events = events;
+
+    // 水平触发且回调执行中时，由 rearm() 应用新事件
+    if (!handler.running || (events & EPOLLET) != 0)
+    {
+        epoll_event event{};
+        event.events = registration(events);
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0)
+        {
+            throw errno_error("Reactor: epoll_ctl failed");
+        }
+    }
+}
+
+bool Reactor::remove(int fd)
+{
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    auto it = handlers.find(fd);
+    if (it == handlers.end())
+    {
+        return false;
+    }
+
+    it->second->removed = true;
+    handlers.erase(it);
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    return true;
+}
+
+size_t Reactor::watched() const
+{
+    std::lock_guard<std::mutex> lock(handlers_mutex);
+    return handlers.size();
+}
+
+Reactor::TimerId Reactor::add_timer(std::chrono::milliseconds delay, std::function<void()> callback,
+                                    std::chrono::milliseconds interval,
+                                    const ThreadPool::TaskOptions &options)
+{
+    check_running();
+    auto deadline = std::chrono::steady_clock::now() + delay;
+    TimerId id;
+    bool earliest;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        id = next_timer_id++;
+        timers.emplace(id, Timer{std::move(callback), interval, options, deadline});
+        earliest = timer_queue.empty() || deadline < timer_queue.top().deadline;
+        timer_queue.push(TimerEntry{deadline, id});
+    }
+
+    // 新定时器比事件循环当前等待的更早到期
+    if (earliest)
+    {
+        wakeup();
+    }
+    return id;
+}
+
+bool Reactor::cancel_timer(TimerId id)
+{
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    return timers.erase(id) != 0;
+}
+
+void Reactor::wakeup()
+{
+    uint64_t one = 1;
+    ssize_t written = ::write(wakeup_fd, &one, sizeof(one));
+    (void)written; // 计数器已满时 EAGAIN，事件循环本来就会被唤醒
+}
+
+int Reactor::next_timeout()
+{
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    while (!timer_queue.empty() && timers.count(timer_queue.top().id) == 0)
+    {
+        timer_queue.pop();
+    }
+    if (timer_queue.empty())
+    {
+        return -1;
+    }
+
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+        timer_queue.top().deadline - std::chrono::steady_clock::now());
+    return remaining.count() > 0 ? static_cast<int>(std::min<int64_t>(remaining.count(), 1 << 30)) : 0;
+}
+
+void Reactor::run_expired_timers()
+{
+    std::vector<std::pair<std::function<void()>, ThreadPool::TaskOptions>> expired;
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        auto now = std::chrono::steady_clock::now();
+        while (!timer_queue.empty() && timer_queue.top().deadline <= now)
+        {
+            TimerEntry entry = timer_queue.top();
+            timer_queue.pop();
+
+            auto it = timers.find(entry.id);
+            if (it == timers.end() || it->second.deadline != entry.deadline)
+            {
+                continue;
+            }
+
+            Timer &timer = it->second;
+            if (timer.interval.count() > 0)
+            {
+                // 周期定时器以上次的到期时间为基准，避免漂移
+                expired.emplace_back(timer.callback, timer.options);
+                timer.deadline = std::max(timer.deadline + timer.interval, now);
+                timer_queue.push(TimerEntry{timer.deadline, entry.id});
+            }
+            else
+            {
+                expired.emplace_back(std::move(timer.callback), timer.options);
+                timers.erase(it);
+            }
+        }
+    }
+
+    for (auto &[callback, options] : expired)
+    {
+        submit(options, std::move(callback));
+    }
+}
+
+void Reactor::submit(const ThreadPool::TaskOptions &options, std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(callbacks_mutex);
+        outstanding_callbacks++;
+    }
+
+    // 持锁通知，析构函数可能在等待最后一个回调
+    auto done = [this]()
+    {
+        std::lock_guard<std::mutex> lock(callbacks_mutex);
+        outstanding_callbacks--;
+        callbacks_done.notify_all();
+    };
+
+    try
+    {
+        pool.submit(options, [task = std::move(task), done]()
+                    {
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                done();
+                throw;
+            }
+            done(); });
+    }
+    catch (const std::runtime_error &)
+    {
+        // 线程池已停止，丢弃回调
+        done();
+    }
+}
+
+void Reactor::dispatch(const std::shared_ptr<Handler> &handler, uint32_t events)
+{
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        if (handler->removed)
+        {
+            return;
+        }
+        if (handler->running)
+        {
+            // 边沿触发：记下事件，回调返回后补发
+            handler->pending |= events;
+            return;
+        }
+        handler->running = true;
+    }
+
+    submit(handler->options, [this, handler, events]()
+           { run_handler(handler, events); });
+}
+
+void Reactor::run_handler(const std::shared_ptr<Handler> &handler, uint32_t events)
+{
+    try
+    {
+        handler->callback(events);
+    }
+    catch (...)
+    {
+        rearm(handler);
+        throw;
+    }
+    rearm(handler);
+}
+
+void Reactor::rearm(const std::shared_ptr<Handler> &handler)
+{
+    uint32_t pending;
+    {
+        std::lock_guard<std::mutex> lock(handlers_mutex);
+        pending = handler->pending;
+        handler->pending = 0;
+
+        if (handler->removed)
+        {
+            handler->running = false;
+            return;
+        }
+
+        if (pending == 0)
+        {
+            handler->running = false;
+            if ((handler->events & EPOLLET) == 0)
+            {
+                epoll_event event{};
+                event.events = registration(handler->events);
+                event.data.fd = handler->fd;
+                ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, handler->fd, &event);
+            }
+            return;
+        }
+    }
+
+    // 补发回调执行期间到达的事件，仍保持 running
+    submit(handler->options, [this, handler, pending]()
+           { run_handler(handler, pending); });
+}
+
+std::error_code Reactor::error() const
+{
+    int code = loop_errno.load();
+    return code == 0 ? std::error_code() : std::error_code(code, std::generic_category());
+}
+
+void Reactor::check_running() const
+{
+    int code = loop_errno.load();
+    if (code != 0)
+    {
+        throw std::system_error(code, std::generic_category(), "Reactor: event loop stopped");
+    }
+}
+
+void Reactor::loop()
+{
+    epoll_event events[max_events];
+    while (!stopping)
+    {
+        int count = ::epoll_wait(epoll_fd, events, max_events, next_timeout());
+        if (count < 0 && errno != EINTR)
+        {
+            // 无法继续等待事件：记录错误供调用者查询，之后的注册会失败而不是静默无效
+            loop_errno = errno;
+            std::cerr << "Reactor: epoll_wait failed: " << std::strerror(loop_errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeup_fd)
+            {
+                uint64_t value;
+                while (::read(wakeup_fd, &value, sizeof(value)) > 0)
+                {
+                }
+                continue;
+            }
+
+            std::shared_ptr<Handler> handler;
+            {
+                std::lock_guard<std::mutex> lock(handlers_mutex);
+                auto it = handlers.find(fd);
+                if (it == handlers.end())
+                {
+                    continue;
+                }
+                handler = it->second;
+            }
+            dispatch(handler, events[i].events);
+        }
+
+        run_expired_timers();
+    }
+}
@@ -0,0 +1,191 @@
+#include "task_tracer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+TaskTracer::Buffer::Buffer(int worker, size_t cap)
+    : slots(new Slot[cap]), capacity(cap), worker_id(worker) {}
+
+void TaskTracer::Buffer::push(const Event &event)
+{
+    size_t index = reserved.fetch_add(1, std::memory_order_relaxed);
+    if (index >= capacity)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    slots[index].event = event;
+    slots[index].ready.store(true, std::memory_order_release);
+}
+
+void TaskTracer::Buffer::collect(std::vector<Event> &out) const
+{
+    size_t count = std::min(reserved.load(std::memory_order_acquire), capacity);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (slots[i].ready.load(std::memory_order_acquire))
+        {
+            out.push_back(slots[i].event);
+        }
+    }
+}
+
+TaskTracer::TaskTracer(size_t events_per_buffer)
+    : events_per_buffer(events_per_buffer),
+      origin(std::chrono::steady_clock::now()),
+      external(external_thread, events_per_buffer) {}
+
+TaskTracer::Buffer *TaskTracer::buffer_for_worker(int worker_id)
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto &buffer : buffers)
+    {
+        if (buffer->worker_id == worker_id)
+        {
+            return buffer.get();
+        }
+    }
+    buffers.push_back(std::make_unique<Buffer>(worker_id, events_per_buffer));
+    return buffers.back().get();
+}
+
+void TaskTracer::record(Buffer *buffer, EventType type, uint64_t task_id,
+                        int priority, const std::string &label)
+{
+    Event event;
+    event.type = type;
+    event.worker_id = buffer != nullptr ? buffer->worker_id : external_thread;
+    event.priority = priority;
+    event.task_id = task_id;
+    event.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - origin)
+                             .count();
+
+    size_t length = std::min(label.size(), max_label_length);
+    std::memcpy(event.label, label.data(), length);
+    event.label[length] = '\0';
+
+    (buffer != nullptr ? buffer : &external)->push(event);
+}
+
+uint64_t TaskTracer::dropped_events() const
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    uint64_t total = external.dropped_events();
+    for (const auto &buffer : buffers)
+    {
+        total += buffer->dropped_events();
+    }
+    return total;
+}
+
+namespace
+{
+    // 转义 JSON 字符串中的特殊字符
+    void write_json_string(std::ostream &out, const char *text)
+    {
+        out << '"';
+        for (const char *p = text; *p != '\0'; ++p)
+        {
+            unsigned char c = static_cast<unsigned char>(*p);
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << *p;
+            }
+            else if (c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            }
+            else
+            {
+                out << *p;
+            }
+        }
+        out << '"';
+    }
+
+    // Chrome trace 的时间戳单位为微秒
+    void write_timestamp(std::ostream &out, int64_t ns)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld.%03lld",
+                      static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+        out << text;
+    }
+}
+
+void TaskTracer::export_chrome_trace(std::ostream &out) const
+{
+    std::vector<Event> events;
+    std::vector<int> worker_ids;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        external.collect(events);
+        for (const auto &buffer : buffers)
+        {
+            buffer->collect(events);
+            worker_ids.push_back(buffer->worker_id);
+        }
+    }
+
+    std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b)
+                     { return a.timestamp_ns < b.timestamp_ns; });
+
+    // tid 0 为提交线程，工作线程 i 对应 tid i + 1
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"ph\":\"M\",\"pid\":1,\"tid\":0,\"name\":\"thread_name\",\"args\":{\"name\":\"submitters\"}}";
+    for (int id : worker_ids)
+    {
+        out << ",\n{\"ph\":\"M\",\"pid\":1,\"tid\":" << id + 1
+            << ",\"name\":\"thread_name\",\"args\":{\"name\":\"worker " << id << "\"}}";
+    }
+
+    for (const Event &event : events)
+    {
+        const char *name = event.label[0] != '\0' ? event.label : "task";
+        int tid = event.worker_id + 1;
+
+        auto write_common = [&](const char *phase, const char *event_name)
+        {
+            out << ",\n{\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+            write_timestamp(out, event.timestamp_ns);
+            out << ",\"name\":";
+            write_json_string(out, event_name);
+        };
+        auto write_args = [&]()
+        {
+            out << ",\"args\":{\"task_id\":" << event.task_id
+                << ",\"priority\":" << event.priority << "}}";
+        };
+
+        switch (event.type)
+        {
+        case EventType::Submit:
+            write_common("i", "submit");
+            out << ",\"s\":\"t\"";
+            write_args();
+            // 流事件把提交和开始执行连接起来，便于观察排队时间
+            write_common("s", name);
+            out << ",\"cat\":\"task\",\"id\":" << event.task_id << "}";
+            break;
+        case EventType::Dequeue:
+            write_common("i", "dequeue");
+            out << ",\"s\":\"t\"";
+            write_args();
+            break;
+        case EventType::Start:
+            write_common("f", name);
+            out << ",\"cat\":\"task\",\"id\":" << event.task_id << ",\"bp\":\"e\"}";
+            write_common("B", name);
+            write_args();
+            break;
+        case EventType::End:
+            write_common("E", name);
+            out << "}";
+            break;
+        }
+    }
+    out << "\n]}\n";
+}
@@ -0,0 +1,1219 @@
+#include "thread_pool.hpp"
+#include <iostream>
+#include <algorithm>
+#include <ctime>
+#include <csignal>
+#include <cstdlib>
+#include <alloca.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <execinfo.h>
+#endif
+
+namespace
+{
+    /**
+     * @brief 预先触碰当前线程栈上的 bytes 字节，使这些页在处理第一个任务前就已映射
+     *
+     * 在独立栈帧中分配并逐页写入，返回后页仍保持映射；lock 为 true 时再用 mlock 锁定，
+     * 避免被换出。大小会被限制在线程栈容量以内，mlock 失败（如 RLIMIT_MEMLOCK 不足）时忽略。
+     */
+    __attribute__((noinline)) void prefault_stack(size_t bytes, bool lock)
+    {
+#ifdef __GLIBC__
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) == 0)
+        {
+            void *stack_addr = nullptr;
+            size_t stack_size = 0;
+            pthread_attr_getstack(&attr, &stack_addr, &stack_size);
+            pthread_attr_destroy(&attr);
+
+            // 为当前已使用的栈和后续调用留出余量
+            const size_t reserve = 64 * 1024;
+            bytes = stack_size > reserve ? std::min(bytes, stack_size - reserve) : 0;
+        }
+#endif
+        if (bytes == 0)
+        {
+            return;
+        }
+
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        volatile char *region = static_cast<volatile char *>(alloca(bytes));
+        for (size_t offset = 0; offset < bytes; offset += page)
+        {
+            region[offset] = 0;
+        }
+        region[bytes - 1] = 0;
+
+        if (lock)
+        {
+            mlock(const_cast<char *>(region), bytes);
+        }
+    }
+
+    // 看门狗采集调用栈：同一时间只采集一个线程，信号处理函数把栈帧写入全局缓冲区
+    constexpr int max_stack_frames = 64;
+    std::mutex capture_mutex;
+    void *capture_frames[max_stack_frames];
+    std::atomic<int> capture_depth{-1};
+
+    int capture_signal()
+    {
+        return SIGRTMIN + 3;
+    }
+
+    void capture_handler(int)
+    {
+#ifdef __GLIBC__
+        capture_depth.store(backtrace(capture_frames, max_stack_frames), std::memory_order_release);
+#else
+        capture_depth.store(0, std::memory_order_release);
+#endif
+    }
+
+    void install_capture_handler()
+    {
+        static std::once_flag installed;
+        std::call_once(installed, []
+                       {
+#ifdef __GLIBC__
+            // 首次调用 backtrace 会加载 libgcc，提前在普通上下文中完成
+            void *warm_up[1];
+            backtrace(warm_up, 1);
+#endif
+            struct sigaction action{};
+            action.sa_handler = capture_handler;
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            sigaction(capture_signal(), &action, nullptr); });
+    }
+
+    /**
+     * @brief 向目标线程发送信号并等待其采集调用栈
+     */
+    std::vector<std::string> capture_stack(pthread_t thread)
+    {
+        std::vector<std::string> stack;
+        std::lock_guard<std::mutex> lock(capture_mutex);
+        capture_depth.store(-1, std::memory_order_relaxed);
+        if (pthread_kill(thread, capture_signal()) != 0)
+        {
+            return stack;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (capture_depth.load(std::memory_order_acquire) < 0 &&
+               std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+#ifdef __GLIBC__
+        int depth = capture_depth.load(std::memory_order_acquire);
+        if (depth > 1)
+        {
+            // 跳过信号处理函数自身
+            char **symbols = backtrace_symbols(capture_frames + 1, depth - 1);
+            if (symbols != nullptr)
+            {
+                stack.assign(symbols, symbols + depth - 1);
+                std::free(symbols);
+            }
+        }
+#endif
+        return stack;
+    }
+}
+
+/**
+ * @brief 计算截止时间，避免 now() + milliseconds::max() 溢出
+ */
+std::chrono::steady_clock::time_point ThreadPool::deadline_after(std::chrono::milliseconds timeout)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (timeout >= std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::time_point::max() - now))
+    {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return now + timeout;
+}
+
+/**
+ * @brief 当前线程已消耗的 CPU 时间
+ */
+std::chrono::nanoseconds ThreadPool::thread_cpu_now()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+ThreadPool::ThreadPool(size_t threads)
+    : stop(false)
+{
+    resize(threads);
+}
+
+ThreadPool::ThreadPool(const Options &options)
+    : stop(false), lazy_start(options.lazy_start),
+      stack_prefault_bytes(options.stack_prefault_bytes), lock_stack(options.lock_stack)
+{
+    resize(options.threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown(ShutdownMode::Drain);
+}
+
+size_t ThreadPool::shutdown(ShutdownMode mode, std::chrono::milliseconds deadline)
+{
+    if (current_pool == this)
+    {
+        throw std::runtime_error("ThreadPool: shutdown called from a worker thread");
+    }
+
+    std::lock_guard<std::mutex> shutdown_lock(shutdown_mutex);
+    if (shut_down)
+    {
+        // 关闭后不能再启用看门狗，这里只是保证析构时不留下可 join 的线程
+        stop_watchdog();
+        return 0;
+    }
+    shut_down = true;
+
+    auto until = deadline_after(deadline);
+    size_t abandoned = 0;
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        stop = true;
+        paused = false;
+    }
+    if (mode == ShutdownMode::Immediate)
+    {
+        interrupt = true;
+    }
+    condition.notify_all();
+
+    if (mode == ShutdownMode::Drain)
+    {
+        // 工作线程在取空队列时通知；到期后放弃剩余任务
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        drained.wait_until(lock, until, [this]
+                           { return queued_entries == 0 || target_workers == 0; });
+    }
+    abandoned = abandon_pending();
+
+    // 先停看门狗，它可能向工作线程发信号，不能在线程被 join 之后还使用其句柄
+    stop_watchdog();
+    for (Worker &worker : workers)
+    {
+        if (worker.thread.joinable())
+        {
+            worker.thread.join();
+        }
+    }
+    return abandoned;
+}
+
+/**
+ * @brief 放弃队列中所有尚未被认领的任务
+ * @return 被放弃的任务数
+ */
+size_t ThreadPool::abandon_pending()
+{
+    std::vector<std::shared_ptr<TaskState>> abandoned;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (Tenant *tenant : tenant_order)
+        {
+            while (!tenant->queue.empty())
+            {
+                abandoned.push_back(tenant->queue.top().state);
+                tenant->queue.pop();
+            }
+            tenant->deficit = 0;
+        }
+        queued_entries = 0;
+    }
+    drained.notify_all();
+    condition.notify_all();
+
+    size_t count = 0;
+    for (auto &state : abandoned)
+    {
+        bool expected = false;
+        if (state->claimed.compare_exchange_strong(expected, true))
+        {
+            state->tenant->pending--;
+            add_counts({&CounterBlock::claimed, &CounterBlock::cancelled});
+            finish(*state);
+            count++;
+        }
+    }
+    return count;
+}
+
+bool ThreadPool::stop_requested()
+{
+    return current_pool != nullptr && current_pool->interrupt;
+}
+
+/**
+ * @brief 记录轨迹事件，未启用时只有一次原子读取的开销
+ */
+void ThreadPool::trace(TaskTracer::EventType type, const TaskState &state)
+{
+    TaskTracer *t = active_tracer.load(std::memory_order_acquire);
+    if (t == nullptr)
+    {
+        return;
+    }
+
+    TaskTracer::Buffer *buffer = nullptr;
+    if (current_pool == this)
+    {
+        if (trace_buffer == nullptr)
+        {
+            trace_buffer = t->buffer_for_worker(current_worker_id);
+        }
+        buffer = trace_buffer;
+    }
+    t->record(buffer, type, state.id, state.priority, state.label);
+}
+
+/**
+ * @brief 在当前线程的计数块中递增若干计数，作为一次原子更新
+ *
+ * 工作线程写自己的块，无需同步；其它线程共用 external_counters，由互斥锁串行化
+ */
+void ThreadPool::add_counts(std::initializer_list<std::atomic<uint64_t> CounterBlock::*> counters)
+{
+    std::unique_lock<std::mutex> lock(external_counters_mutex, std::defer_lock);
+    CounterBlock *block;
+    if (current_pool == this && current_context != nullptr)
+    {
+        block = &current_context->counters;
+    }
+    else
+    {
+        lock.lock();
+        block = &external_counters;
+    }
+
+    // 单写者：普通的读后写即可，不需要 RMW 指令
+    uint64_t sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (auto counter : counters)
+    {
+        auto &value = block->*counter;
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    block->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/**
+ * @brief 汇总所有计数块
+ *
+ * 逐块用 seqlock 读取一致的值；一个任务的认领和结束记在同一个块中，
+ * 因此各块之间无需同时冻结，汇总结果仍满足 running = claimed - 已结束 >= 0。
+ * submitted 最后读取：任务入队先于被认领，读到的 submitted 不小于 claimed。
+ */
+ThreadPool::Counts ThreadPool::collect_counts() const
+{
+    Counts total;
+    for (const CounterBlock *block = counter_blocks.load(std::memory_order_acquire);
+         block != nullptr; block = block->next)
+    {
+        Counts part;
+        while (true)
+        {
+            uint64_t before = block->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            part.claimed = block->claimed.load(std::memory_order_relaxed);
+            part.completed = block->completed.load(std::memory_order_relaxed);
+            part.failed = block->failed.load(std::memory_order_relaxed);
+            part.timeout = block->timeout.load(std::memory_order_relaxed);
+            part.cancelled = block->cancelled.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (block->sequence.load(std::memory_order_relaxed) == before)
+            {
+                break;
+            }
+        }
+        total.claimed += part.claimed;
+        total.completed += part.completed;
+        total.failed += part.failed;
+        total.timeout += part.timeout;
+        total.cancelled += part.cancelled;
+    }
+    total.submitted = submitted_tasks->load(std::memory_order_acquire);
+    return total;
+}
+
+/**
+ * @brief 认领任务，保证每个任务只被一个线程执行
+ * @return 认领成功返回 true
+ */
+bool ThreadPool::try_claim(TaskState &state)
+{
+    bool expected = false;
+    if (state.claimed.compare_exchange_strong(expected, true))
+    {
+        state.tenant->pending--;
+        add_counts({&CounterBlock::claimed});
+        trace(TaskTracer::EventType::Dequeue, state);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 执行一个已认领的任务
+ *
+ * 包含了任务超时检查、取消检查和异常处理
+ */
+void ThreadPool::execute(const std::shared_ptr<TaskState> &state)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (state->deadline < now)
+    {
+        add_counts({&CounterBlock::timeout});
+    }
+    else if (state->cancelled)
+    {
+        add_counts({&CounterBlock::cancelled});
+    }
+    else
+    {
+        // 嵌套执行（协助等待）时当前线程已计入活跃线程
+        if (task_depth++ == 0)
+        {
+            (*active_threads)++;
+        }
+
+        // 记录当前任务供看门狗检查；协助等待时内联执行的任务结束后恢复外层任务
+        std::shared_ptr<TaskState> outer_task;
+        std::chrono::steady_clock::time_point outer_started;
+        if (current_context != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(current_context->mutex);
+            outer_task = std::move(current_context->task);
+            outer_started = current_context->started;
+            current_context->task = state;
+            current_context->started = std::chrono::steady_clock::now();
+        }
+
+        TaskState *outer_current = current_task;
+        current_task = state.get();
+
+        // 子任务的 CPU 时间单独计入子任务，从父任务中扣除
+        auto saved_nested_cpu = nested_cpu_time;
+        nested_cpu_time = std::chrono::nanoseconds(0);
+        auto wall_start = std::chrono::steady_clock::now();
+        auto cpu_start = thread_cpu_now();
+
+        trace(TaskTracer::EventType::Start, *state);
+        try
+        {
+            state->func();
+            add_counts({&CounterBlock::completed});
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Task exception: " << e.what() << std::endl;
+            add_counts({&CounterBlock::failed});
+        }
+        catch (...)
+        {
+            std::cerr << "Unknown task exception" << std::endl;
+            add_counts({&CounterBlock::failed});
+        }
+
+        trace(TaskTracer::EventType::End, *state);
+
+        auto cpu_total = thread_cpu_now() - cpu_start;
+        state->timing.cpu_time = cpu_total - nested_cpu_time;
+        state->timing.wall_time = std::chrono::steady_clock::now() - wall_start;
+        nested_cpu_time = saved_nested_cpu + cpu_total;
+
+        {
+            std::lock_guard<std::mutex> lock(timing_mutex);
+            LabelTiming &sum = label_timings[state->label];
+            sum.tasks++;
+            sum.cpu_time += state->timing.cpu_time;
+            sum.wall_time += state->timing.wall_time;
+        }
+
+        current_task = outer_current;
+
+        if (current_context != nullptr)
+        {
+            std::lock_guard<std::mutex> lock(current_context->mutex);
+            current_context->task = std::move(outer_task);
+            current_context->started = outer_started;
+        }
+
+        if (--task_depth == 0)
+        {
+            (*active_threads)--;
+        }
+    }
+
+    state->tenant->executed++;
+    release_slot(*state->tenant);
+    finish(*state);
+}
+
+/**
+ * @brief 标记任务处理完毕并唤醒协助等待者
+ */
+void ThreadPool::finish(TaskState &state)
+{
+    // 释放任务函数，未执行的任务会因此使其 future 以 broken_promise 结束
+    state.func = nullptr;
+    state.done = true;
+
+    // 唤醒正在协助等待该任务的工作线程
+    if (state.waiters > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+        }
+        condition.notify_all();
+    }
+}
+
+/**
+ * @brief 工作线程的主循环函数
+ *
+ * 工作线程不断从任务队列中获取任务并执行，直到线程池停止
+ */
+void ThreadPool::worker_thread(int worker_id)
+{
+    current_pool = this;
+    current_worker_id = worker_id;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        current_context = workers[worker_id].context.get();
+    }
+    {
+        std::lock_guard<std::mutex> lock(current_context->mutex);
+        current_context->native = pthread_self();
+    }
+
+    // 最后析构：退出前等看门狗完成对本线程的信号采集，否则线程可能在 pthread_kill 之前被 join
+    struct CaptureFence
+    {
+        WorkerContext *context;
+        ~CaptureFence()
+        {
+            std::unique_lock<std::mutex> lock(context->mutex);
+            context->capture_done.wait(lock, [this]
+                                       { return !context->capturing; });
+        }
+    } capture_fence{current_context};
+
+    if (stack_prefault_bytes > 0)
+    {
+        prefault_stack(stack_prefault_bytes, lock_stack);
+    }
+
+    bool counted_idle = true; // 创建线程时已计入 idle_workers
+    while (true)
+    {
+        std::shared_ptr<TaskState> state;
+
+        // 获取任务
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            if (!counted_idle)
+            {
+                idle_workers++;
+                counted_idle = true;
+            }
+
+            // 等待直到有可分派的任务、停止且队列为空或被缩容
+            condition.wait(lock, [this, worker_id]
+                           { return can_dispatch() || (stop && queued_entries == 0) ||
+                                    static_cast<size_t>(worker_id) >= target_workers; });
+
+            // 缩容：多余的线程直接退出，队列中的任务留给其它线程
+            if (static_cast<size_t>(worker_id) >= target_workers)
+            {
+                workers[worker_id].retired = true;
+                idle_workers--;
+                return;
+            }
+
+            // 如果线程池停止且没有待处理任务，则退出
+            if (stop && queued_entries == 0)
+            {
+                idle_workers--;
+                return;
+            }
+
+            // 队列中只剩残留条目时 pop_task 会将其清理并返回空
+            state = pop_task();
+            if (!state)
+            {
+                continue;
+            }
+            idle_workers--;
+            counted_idle = false;
+        }
+
+        // 在出队和认领之间被等待者内联执行的任务直接丢弃
+        if (try_claim(*state))
+        {
+            execute(state);
+        }
+        else
+        {
+            release_slot(*state->tenant);
+        }
+    }
+}
+
+/**
+ * @brief 把任务放入所属租户的队列并唤醒一个工作线程，自行获取 queue_mutex
+ *
+ * 线程池已停止时，普通任务抛出 std::runtime_error；延迟任务被直接放弃。
+ */
+void ThreadPool::enqueue(const std::shared_ptr<TaskState> &state, const std::string &tenant_name, bool deferred)
+{
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+
+        if (stop)
+        {
+            if (!deferred)
+            {
+                throw std::runtime_error("ThreadPool: submitting on a stopped pool");
+            }
+
+            // 延迟任务在关闭之后才就绪，直接放弃；仍计入提交数以保持计数守恒
+            submitted_tasks->fetch_add(1, std::memory_order_release);
+            lock.unlock();
+            add_counts({&CounterBlock::claimed, &CounterBlock::cancelled});
+            finish(*state);
+            return;
+        }
+
+        Tenant &tenant = tenant_for(tenant_name);
+        state->tenant = &tenant;
+        state->claimed = false;
+
+        trace(TaskTracer::EventType::Submit, *state);
+        tenant.queue.push(Task{state, state->effective_priority});
+        tenant.pending++;
+        queued_entries++;
+        submitted_tasks->fetch_add(1, std::memory_order_release);
+
+        // 延迟启动：排队的任务多于空闲线程时补充一个线程
+        if (lazy_start && queued_entries > idle_workers)
+        {
+            spawn_worker();
+        }
+    }
+
+    condition.notify_one();
+}
+
+/**
+ * @brief 查找或创建租户，调用者需持有 queue_mutex
+ */
+ThreadPool::Tenant &ThreadPool::tenant_for(const std::string &name)
+{
+    auto it = tenants.find(name);
+    if (it != tenants.end())
+    {
+        return it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(tenant_mutex);
+    Tenant &tenant = tenants[name];
+    tenant.name = name;
+    tenant_order.push_back(&tenant);
+    return tenant;
+}
+
+bool ThreadPool::has_capacity(const Tenant &tenant) const
+{
+    size_t limit = tenant.max_concurrency;
+    return limit == 0 || tenant.running < limit;
+}
+
+/**
+ * @brief 是否有可分派的任务，调用者需持有 queue_mutex
+ *
+ * 残留条目也会使其返回 true，由 pop_task 负责清理
+ */
+bool ThreadPool::can_dispatch() const
+{
+    if (paused)
+    {
+        return false;
+    }
+    for (const Tenant *tenant : tenant_order)
+    {
+        if (!tenant->queue.empty() && has_capacity(*tenant))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 按差额轮询选出下一个任务，调用者需持有 queue_mutex
+ *
+ * 选中的任务会占用租户的一个并发名额，由 release_slot 归还
+ * @return 没有可分派的任务时返回空
+ */
+std::shared_ptr<ThreadPool::TaskState> ThreadPool::pop_task()
+{
+    if (paused || tenant_order.empty())
+    {
+        return nullptr;
+    }
+
+    // 每个租户最多被访问两次：第一次可能只是发放配额
+    for (size_t visited = 0; visited <= 2 * tenant_order.size(); ++visited)
+    {
+        Tenant &tenant = *tenant_order[tenant_cursor];
+
+        // 丢弃已被等待者内联执行的残留条目
+        while (!tenant.queue.empty() && tenant.queue.top().state->claimed)
+        {
+            tenant.queue.pop();
+            queued_entries--;
+        }
+
+        if (tenant.queue.empty())
+        {
+            tenant.deficit = 0;
+        }
+        else if (tenant.deficit > 0 && has_capacity(tenant))
+        {
+            tenant.deficit--;
+            std::shared_ptr<TaskState> state = tenant.queue.top().state;
+            tenant.queue.pop();
+            queued_entries--;
+            tenant.running++;
+
+            if (stop && queued_entries == 0)
+            {
+                drained.notify_all();
+            }
+            return state;
+        }
+
+        // 本轮配额用完、队列为空或达到并发上限：轮到下一个租户并发放配额
+        tenant_cursor = (tenant_cursor + 1) % tenant_order.size();
+        Tenant &next = *tenant_order[tenant_cursor];
+        if (!next.queue.empty() && has_capacity(next))
+        {
+            next.deficit += next.weight;
+        }
+    }
+
+    if (stop && queued_entries == 0)
+    {
+        drained.notify_all();
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 归还租户的并发名额，有并发上限的租户需要唤醒等待的工作线程
+ *
+ * 总是在 queue_mutex 下递减并读取上限：configure_tenant 可能同时把上限从 0 调高，
+ * 无锁递减会让按新上限等待的工作线程错过唤醒。
+ */
+void ThreadPool::release_slot(Tenant &tenant)
+{
+    bool capped;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        tenant.running--;
+        capped = tenant.max_concurrency != 0;
+    }
+    if (capped)
+    {
+        condition.notify_all();
+    }
+}
+
+/**
+ * @brief 从队列中取出一个任务并在当前线程执行
+ * @return 如果执行（或丢弃）了一个任务返回 true，队列为空时返回 false
+ */
+bool ThreadPool::run_one_pending()
+{
+    std::shared_ptr<TaskState> state;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        state = pop_task();
+        if (!state)
+        {
+            return false;
+        }
+    }
+
+    if (try_claim(*state))
+    {
+        execute(state);
+    }
+    else
+    {
+        release_slot(*state->tenant);
+    }
+    return true;
+}
+
+/**
+ * @brief 工作线程等待本池任务时的协助循环
+ *
+ * 1. 目标任务尚未被认领：直接在当前线程内联执行
+ * 2. 目标任务正在其它线程执行：执行队列中的其它任务
+ * 3. 队列为空：在条件变量上等待新任务或目标完成
+ */
+void ThreadPool::help_until_done(const std::shared_ptr<TaskState> &target)
+{
+    // 内联执行直接依赖的任务不受租户并发上限约束，否则可能死锁
+    if (try_claim(*target))
+    {
+        target->tenant->running++;
+        execute(target);
+        return;
+    }
+
+    // 目标已在别处执行或尚未入队：记录等待关系并把优先级传给它
+    TaskState *self = current_task;
+    if (self != nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            self->waiting_on = target;
+        }
+        boost(target, self->effective_priority);
+    }
+
+    target->waiters++;
+    while (!target->done)
+    {
+        if (run_one_pending())
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        condition.wait(lock, [this, &target]
+                       { return target->done || can_dispatch(); });
+    }
+    target->waiters--;
+
+    if (self != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        self->waiting_on.reset();
+    }
+}
+
+void ThreadPool::boost(std::shared_ptr<TaskState> target, int priority)
+{
+    bool requeued = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+
+        // 沿等待链传递：被等待的任务若正在执行并等待其它任务，一并提升；
+        // 链上每个任务只会被提升一次到同一优先级，不会在环上无限循环
+        while (target && !target->done && target->effective_priority < priority)
+        {
+            target->effective_priority = priority;
+            priority_boosts++;
+
+            // 仍在队列中：以新优先级重新入堆，旧条目被认领后作为残留条目丢弃
+            if (!target->claimed && target->tenant != nullptr)
+            {
+                target->tenant->queue.push(Task{target, priority});
+                queued_entries++;
+                requeued = true;
+            }
+            target = target->waiting_on;
+        }
+    }
+
+    if (requeued)
+    {
+        condition.notify_one();
+    }
+}
+
+void ThreadPool::configure_tenant(const std::string &name, unsigned weight, size_t max_concurrency)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        Tenant &tenant = tenant_for(name);
+        tenant.weight = weight > 0 ? weight : 1;
+        tenant.max_concurrency = max_concurrency;
+    }
+    condition.notify_all();
+}
+
+/**
+ * @brief 在第一个空槽位上创建工作线程，调用者需持有 queue_mutex
+ * @return 没有空槽位时返回 false
+ */
+bool ThreadPool::spawn_worker()
+{
+    for (size_t i = 0; i < target_workers; ++i)
+    {
+        if (!workers[i].thread.joinable())
+        {
+            if (!workers[i].context)
+            {
+                workers[i].context = std::make_unique<WorkerContext>();
+
+                // 发布计数块，读者无需 queue_mutex 即可遍历
+                CounterBlock *block = &workers[i].context->counters;
+                block->next = counter_blocks.load(std::memory_order_relaxed);
+                counter_blocks.store(block, std::memory_order_release);
+            }
+            // 新线程在进入等待前就计为空闲，避免连续提交时重复创建
+            idle_workers++;
+            workers[i].thread = std::thread([this, i]
+                                            { worker_thread(static_cast<int>(i)); });
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::warm_up()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stop)
+        {
+            return;
+        }
+        while (spawn_worker())
+        {
+        }
+    }
+    condition.notify_all();
+}
+
+size_t ThreadPool::live_threads() const
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    size_t count = 0;
+    for (const Worker &worker : workers)
+    {
+        count += worker.thread.joinable() && !worker.retired;
+    }
+    return count;
+}
+
+void ThreadPool::resize(size_t threads)
+{
+    std::lock_guard<std::mutex> shutdown_lock(shutdown_mutex);
+    if (shut_down)
+    {
+        throw std::runtime_error("ThreadPool: resizing a stopped pool");
+    }
+
+    std::vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        target_workers = threads;
+
+        // 回收已退出的线程；仍在运行的多余线程会在下次检查时退出
+        for (Worker &worker : workers)
+        {
+            if (worker.retired)
+            {
+                finished.push_back(std::move(worker.thread));
+                worker.retired = false;
+            }
+        }
+
+        // 为空槽位创建新线程，尚未退出的线程看到新的目标值后会继续工作；
+        // 延迟启动模式下只扩大槽位，线程在提交任务时按需创建
+        if (workers.size() < threads)
+        {
+            workers.resize(threads);
+        }
+        while (!lazy_start && spawn_worker())
+        {
+        }
+    }
+    condition.notify_all();
+
+    for (std::thread &thread : finished)
+    {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::size() const
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return target_workers;
+}
+
+void ThreadPool::pause()
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    paused = true;
+}
+
+void ThreadPool::resume()
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        paused = false;
+    }
+    condition.notify_all();
+}
+
+bool ThreadPool::is_paused() const
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return paused;
+}
+
+size_t ThreadPool::get_pending_tasks() const
+{
+    Counts counts = collect_counts();
+    return static_cast<size_t>(counts.submitted - counts.claimed);
+}
+
+ThreadPool::Statistics ThreadPool::get_statistics() const
+{
+    Counts counts = collect_counts();
+    Statistics stats{
+        active_threads->load(),
+        counts.completed,
+        counts.failed,
+        counts.timeout,
+        counts.cancelled,
+        static_cast<size_t>(counts.submitted - counts.claimed),
+        static_cast<size_t>(counts.claimed - counts.completed - counts.failed - counts.timeout - counts.cancelled),
+        counts.submitted,
+        stuck_tasks,
+        priority_boosts,
+        std::chrono::nanoseconds(0),
+        std::chrono::nanoseconds(0),
+        {},
+        {}};
+
+    {
+        std::lock_guard<std::mutex> lock(timing_mutex);
+        stats.per_label = label_timings;
+    }
+    {
+        std::lock_guard<std::mutex> lock(tenant_mutex);
+        for (const auto &[name, tenant] : tenants)
+        {
+            stats.per_tenant[name] = TenantStatistics{
+                tenant.weight,
+                tenant.max_concurrency,
+                tenant.pending,
+                tenant.running,
+                tenant.executed};
+        }
+    }
+    for (const auto &[label, timing] : stats.per_label)
+    {
+        stats.total_cpu_time += timing.cpu_time;
+        stats.total_wall_time += timing.wall_time;
+    }
+    return stats;
+}
+
+bool ThreadPool::wait_all(std::chrono::milliseconds timeout)
+{
+    // 默认超时为 milliseconds::max()，直接与纳秒时长比较会溢出
+    auto deadline = deadline_after(timeout);
+    while (true)
+    {
+        // 同一快照中既无待认领也无执行中的任务；分开读取待处理数和活跃线程数时，
+        // 任务刚被认领、尚未计入活跃线程的瞬间会被误判为全部完成
+        Counts counts = collect_counts();
+        if (counts.submitted == counts.claimed &&
+            counts.claimed == counts.completed + counts.failed + counts.timeout + counts.cancelled)
+        {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void ThreadPool::enable_tracing(size_t events_per_buffer)
+{
+    std::lock_guard<std::mutex> lock(tracer_mutex);
+    if (!tracer)
+    {
+        tracer = std::make_unique<TaskTracer>(events_per_buffer);
+    }
+    active_tracer.store(tracer.get(), std::memory_order_release);
+}
+
+void ThreadPool::disable_tracing()
+{
+    active_tracer.store(nullptr, std::memory_order_release);
+}
+
+bool ThreadPool::export_trace(std::ostream &out)
+{
+    std::lock_guard<std::mutex> lock(tracer_mutex);
+    if (!tracer)
+    {
+        return false;
+    }
+    tracer->export_chrome_trace(out);
+    return true;
+}
+
+/**
+ * @brief 替换看门狗线程
+ *
+ * 检查是否已关闭、让旧线程退出并安装新线程在同一临界区内完成，旧线程由本次调用 join，
+ * 并发的启用和停止各自只 join 自己取走的线程。shutdown() 在置位 stop 之后才停止看门狗，
+ * 因此它要么 join 这里创建的线程，要么让这里看到 stop 而抛出。
+ */
+void ThreadPool::enable_watchdog(std::chrono::milliseconds budget,
+                                 std::function<void(const StuckTaskReport &)> callback)
+{
+    install_capture_handler();
+
+    std::thread previous;
+    {
+        std::lock_guard<std::mutex> lock(watchdog_mutex);
+        if (stop)
+        {
+            throw std::runtime_error("ThreadPool: enabling the watchdog on a stopped pool");
+        }
+        uint64_t generation = ++watchdog_generation;
+        previous = std::move(watchdog);
+        watchdog = std::thread([this, budget, generation, callback = std::move(callback)]
+                               {
+            auto interval = std::max(budget / 4, std::chrono::milliseconds(1));
+            std::unique_lock<std::mutex> lock(watchdog_mutex);
+            while (!watchdog_condition.wait_for(lock, interval, [this, generation]
+                                                { return watchdog_generation != generation; }))
+            {
+                lock.unlock();
+                check_stuck_workers(budget, callback);
+                lock.lock();
+            } });
+    }
+    watchdog_condition.notify_all();
+    if (previous.joinable())
+    {
+        previous.join();
+    }
+}
+
+void ThreadPool::disable_watchdog()
+{
+    stop_watchdog();
+}
+
+void ThreadPool::stop_watchdog()
+{
+    std::thread previous;
+    {
+        std::lock_guard<std::mutex> lock(watchdog_mutex);
+        watchdog_generation++;
+        previous = std::move(watchdog);
+    }
+    watchdog_condition.notify_all();
+    if (previous.joinable())
+    {
+        previous.join();
+    }
+}
+
+/**
+ * @brief 检查每个工作线程当前任务的运行时间，超过预算的任务上报一次
+ */
+void ThreadPool::check_stuck_workers(std::chrono::milliseconds budget,
+                                     const std::function<void(const StuckTaskReport &)> &callback)
+{
+    std::vector<std::pair<int, WorkerContext *>> contexts;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (size_t i = 0; i < workers.size(); ++i)
+        {
+            if (workers[i].context)
+            {
+                contexts.emplace_back(static_cast<int>(i), workers[i].context.get());
+            }
+        }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto [worker_id, context] : contexts)
+    {
+        std::shared_ptr<TaskState> task;
+        pthread_t native;
+        std::chrono::steady_clock::duration elapsed;
+        {
+            std::lock_guard<std::mutex> lock(context->mutex);
+            if (!context->task || context->reported_task == context->task->id)
+            {
+                continue;
+            }
+            elapsed = now - context->started;
+            if (elapsed < budget)
+            {
+                continue;
+            }
+            task = context->task;
+            native = context->native;
+            context->reported_task = task->id;
+            // 有任务时线程一定还在运行；置位后它在退出前会等待采集结束
+            context->capturing = true;
+        }
+
+        StuckTaskReport report{
+            worker_id,
+            task->id,
+            task->label,
+            task->tenant->name,
+            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed),
+            capture_stack(native)};
+
+        // 采集期间任务已结束，调用栈属于其它任务，不再有意义
+        {
+            std::lock_guard<std::mutex> lock(context->mutex);
+            context->capturing = false;
+            if (context->task != task)
+            {
+                report.stack.clear();
+            }
+        }
+        context->capture_done.notify_all();
+
+        stuck_tasks++;
+        callback(report);
+    }
+}
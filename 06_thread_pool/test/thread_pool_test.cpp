@@ -0,0 +1,1093 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <atomic>
+#include <cstdlib>
+#include <system_error>
+#include <unistd.h>
+#include "cache_padded.hpp"
+#include "thread_pool.hpp"
+#include "io_executor.hpp"
+#include "reactor.hpp"
+#include "fiber.hpp"
+#include "task_coalescer.hpp"
+#include <sys/socket.h>
+
+void test_submit_and_statistics()
+{
+    ThreadPool pool(2);
+    std::vector<ThreadPool::TaskFuture<int>> results;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        results.push_back(pool.submit(i, std::chrono::milliseconds(5000),
+                                      [](int x)
+                                      { return x * x; },
+                                      i));
+    }
+
+    for (int i = 0; i < 10; ++i)
+    {
+        assert(results[i].get() == i * i);
+    }
+
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+    auto stats = pool.get_statistics();
+    assert(stats.completed_tasks == 10);
+    assert(stats.pending_tasks == 0);
+}
+
+int fib(ThreadPool &pool, int n)
+{
+    if (n < 2)
+    {
+        return n;
+    }
+    auto left = pool.submit(0, std::chrono::milliseconds::max(), fib, std::ref(pool), n - 1);
+    auto right = pool.submit(0, std::chrono::milliseconds::max(), fib, std::ref(pool), n - 2);
+    return left.get() + right.get();
+}
+
+void test_nested_wait_does_not_deadlock()
+{
+    // 单个工作线程：任务等待自己提交的子任务时必须协助执行
+    ThreadPool pool(1);
+    auto result = pool.submit(0, std::chrono::milliseconds::max(), fib, std::ref(pool), 15);
+    assert(result.get() == 610);
+
+    ThreadPool pool2(2);
+    std::vector<ThreadPool::TaskFuture<int>> results;
+    for (int i = 0; i < 4; ++i)
+    {
+        results.push_back(pool2.submit(0, std::chrono::milliseconds::max(), fib, std::ref(pool2), 12));
+    }
+    for (auto &r : results)
+    {
+        assert(r.get() == 144);
+    }
+}
+
+void test_cancel()
+{
+    ThreadPool pool(1);
+    std::promise<void> gate;
+    auto blocker = pool.submit(10, std::chrono::milliseconds::max(), [&gate]
+                               { gate.get_future().wait(); });
+    auto victim = pool.submit(0, std::chrono::milliseconds::max(), []
+                              { return 1; });
+    victim.cancel();
+    gate.set_value();
+
+    bool broken = false;
+    try
+    {
+        victim.get();
+    }
+    catch (const std::future_error &)
+    {
+        broken = true;
+    }
+    assert(broken);
+    blocker.get();
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+    assert(pool.get_statistics().cancelled_tasks == 1);
+}
+
+size_t count_occurrences(const std::string &text, const std::string &pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1))
+    {
+        ++count;
+    }
+    return count;
+}
+
+void test_tracing()
+{
+    ThreadPool pool(2);
+    std::ostringstream empty;
+    assert(!pool.export_trace(empty));
+
+    pool.enable_tracing();
+    std::vector<ThreadPool::TaskFuture<void>> results;
+    for (int i = 0; i < 5; ++i)
+    {
+        ThreadPool::TaskOptions options;
+        options.priority = i;
+        options.label = "job \"" + std::to_string(i) + "\"";
+        results.push_back(pool.submit(options, [] {}));
+    }
+    for (auto &r : results)
+    {
+        r.get();
+    }
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+
+    std::ostringstream out;
+    assert(pool.export_trace(out));
+    std::string json = out.str();
+    assert(count_occurrences(json, "\"ph\":\"B\"") == 5);
+    assert(count_occurrences(json, "\"ph\":\"E\"") == 5);
+    assert(count_occurrences(json, "\"name\":\"submit\"") == 5);
+    assert(count_occurrences(json, "\"name\":\"dequeue\"") == 5);
+    assert(json.find("job \\\"3\\\"") != std::string::npos);
+}
+
+void test_timing()
+{
+    ThreadPool pool(1);
+
+    ThreadPool::TaskOptions sleeper;
+    sleeper.label = "sleep";
+    auto slept = pool.submit(sleeper, []
+                             { std::this_thread::sleep_for(std::chrono::milliseconds(50)); });
+
+    ThreadPool::TaskOptions spinner;
+    spinner.label = "spin";
+    auto spun = pool.submit(spinner, []
+                            {
+        auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+        while (std::chrono::steady_clock::now() < end) {} });
+
+    slept.get();
+    auto slept_timing = slept.timing();
+    auto spun_timing = spun.timing();
+
+    // 阻塞任务墙钟时间长但几乎不消耗 CPU，忙等任务则相反
+    assert(slept_timing.wall_time >= std::chrono::milliseconds(50));
+    assert(slept_timing.cpu_time < std::chrono::milliseconds(10));
+    assert(spun_timing.cpu_time >= std::chrono::milliseconds(1));
+
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+    auto stats = pool.get_statistics();
+    assert(stats.per_label.at("sleep").tasks == 1);
+    assert(stats.per_label.at("spin").tasks == 1);
+    assert(stats.total_wall_time >= slept_timing.wall_time + spun_timing.wall_time);
+}
+
+void test_shutdown_drain_deadline()
+{
+    ThreadPool pool(1);
+    std::vector<ThreadPool::TaskFuture<void>> results;
+    for (int i = 0; i < 20; ++i)
+    {
+        results.push_back(pool.submit(0, std::chrono::milliseconds::max(), []
+                                      { std::this_thread::sleep_for(std::chrono::milliseconds(20)); }));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t abandoned = pool.shutdown(ThreadPool::ShutdownMode::Drain, std::chrono::milliseconds(50));
+    assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+    assert(abandoned > 0 && abandoned < 20);
+
+    size_t broken = 0;
+    for (auto &r : results)
+    {
+        try
+        {
+            r.get();
+        }
+        catch (const std::future_error &)
+        {
+            broken++;
+        }
+    }
+    assert(broken == abandoned);
+
+    auto stats = pool.get_statistics();
+    assert(stats.completed_tasks + stats.cancelled_tasks == 20);
+    assert(pool.shutdown() == 0);
+
+    bool rejected = false;
+    try
+    {
+        pool.submit(0, std::chrono::milliseconds::max(), [] {});
+    }
+    catch (const std::runtime_error &)
+    {
+        rejected = true;
+    }
+    assert(rejected);
+}
+
+void test_shutdown_cancel_pending()
+{
+    ThreadPool pool(1);
+    std::promise<void> started;
+    auto running = pool.submit(10, std::chrono::milliseconds::max(), [&started]
+                               {
+        started.set_value();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        return 7; });
+    for (int i = 0; i < 5; ++i)
+    {
+        pool.submit(0, std::chrono::milliseconds::max(), [] {});
+    }
+    started.get_future().wait();
+
+    assert(pool.shutdown(ThreadPool::ShutdownMode::CancelPending) == 5);
+    assert(running.get() == 7);
+}
+
+void test_shutdown_immediate()
+{
+    ThreadPool pool(1);
+    std::promise<void> started;
+    auto looping = pool.submit(10, std::chrono::milliseconds::max(), [&started]
+                               {
+        started.set_value();
+        int iterations = 0;
+        while (!ThreadPool::stop_requested())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            iterations++;
+        }
+        return iterations; });
+    pool.submit(0, std::chrono::milliseconds::max(), [] {});
+    started.get_future().wait();
+
+    assert(!ThreadPool::stop_requested());
+    assert(pool.shutdown(ThreadPool::ShutdownMode::Immediate) == 1);
+    assert(looping.get() >= 0);
+}
+
+void test_pause_resume()
+{
+    ThreadPool pool(2);
+    pool.pause();
+    assert(pool.is_paused());
+
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 3; ++i)
+    {
+        pool.submit(0, std::chrono::milliseconds::max(), [&ran]
+                    { ran++; });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    assert(ran == 0);
+    assert(pool.get_pending_tasks() == 3);
+
+    pool.resume();
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+    assert(ran == 3);
+}
+
+void test_resize()
+{
+    ThreadPool pool(1);
+    assert(pool.size() == 1);
+
+    // 扩容到 4 个线程后，4 个互相等待的任务能同时运行
+    pool.resize(4);
+    assert(pool.size() == 4);
+    std::atomic<int> arrived{0};
+    std::vector<ThreadPool::TaskFuture<void>> results;
+    for (int i = 0; i < 4; ++i)
+    {
+        results.push_back(pool.submit(0, std::chrono::milliseconds::max(), [&arrived]
+                                      {
+            arrived++;
+            while (arrived < 4)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            } }));
+    }
+    for (auto &r : results)
+    {
+        r.get();
+    }
+
+    // 缩容不丢失队列中的任务
+    pool.pause();
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 10; ++i)
+    {
+        pool.submit(0, std::chrono::milliseconds::max(), [&ran]
+                    { ran++; });
+    }
+    pool.resize(1);
+    pool.resume();
+    assert(pool.wait_all(std::chrono::milliseconds(1000)));
+    assert(ran == 10);
+
+    // 缩容到 0 后再扩容
+    pool.resize(0);
+    pool.resize(2);
+    auto result = pool.submit(0, std::chrono::milliseconds::max(), []
+                              { return 42; });
+    assert(result.get() == 42);
+}
+
+void test_weighted_tenants()
+{
+    ThreadPool pool(1);
+    pool.configure_tenant("heavy", 3);
+    pool.configure_tenant("light", 1);
+    pool.pause();
+
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    for (int i = 0; i < 40; ++i)
+    {
+        for (const char *name : {"heavy", "light"})
+        {
+            ThreadPool::TaskOptions options;
+            options.tenant = name;
+            // light 租户的优先级更高，但不能因此饿死 heavy 租户
+            options.priority = std::string(name) == "light" ? 9 : 0;
+            pool.submit(options, [&order_mutex, &order, name]
+                        {
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order.push_back(name); });
+        }
+    }
+
+    auto before = pool.get_statistics();
+    assert(before.per_tenant.at("heavy").pending_tasks == 40);
+    assert(before.per_tenant.at("heavy").weight == 3);
+
+    pool.resume();
+    assert(pool.wait_all(std::chrono::milliseconds(2000)));
+
+    // 两个租户都有积压时，吞吐量按 3:1 分配
+    int heavy = 0;
+    for (size_t i = 0; i < 40; ++i)
+    {
+        heavy += order[i] == "heavy";
+    }
+    assert(heavy >= 28 && heavy <= 32);
+
+    auto after = pool.get_statistics();
+    assert(after.per_tenant.at("heavy").executed_tasks == 40);
+    assert(after.per_tenant.at("light").executed_tasks == 40);
+    assert(after.per_tenant.at("light").pending_tasks == 0);
+}
+
+void test_tenant_concurrency_cap()
+{
+    ThreadPool pool(4);
+    pool.configure_tenant("capped", 1, 1);
+
+    std::atomic<int> running{0};
+    std::atomic<int> max_running{0};
+    std::vector<ThreadPool::TaskFuture<void>> results;
+    for (int i = 0; i < 6; ++i)
+    {
+        ThreadPool::TaskOptions options;
+        options.tenant = "capped";
+        results.push_back(pool.submit(options, [&running, &max_running]
+                                      {
+            int now = ++running;
+            int seen = max_running;
+            while (now > seen && !max_running.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            running--; }));
+    }
+    for (auto &r : results)
+    {
+        r.get();
+    }
+    assert(max_running == 1);
+}
+
+void test_watchdog()
+{
+    ThreadPool pool(2);
+    std::mutex reports_mutex;
+    std::vector<ThreadPool::StuckTaskReport> reports;
+    pool.enable_watchdog(std::chrono::milliseconds(20), [&](const ThreadPool::StuckTaskReport &report)
+                         {
+        std::lock_guard<std::mutex> lock(reports_mutex);
+        reports.push_back(report); });
+
+    ThreadPool::TaskOptions hang;
+    hang.label = "hang";
+    auto slow = pool.submit(hang, []
+                            { std::this_thread::sleep_for(std::chrono::milliseconds(150)); });
+    ThreadPool::TaskOptions quick;
+    quick.label = "quick";
+    auto fast = pool.submit(quick, [] {});
+
+    slow.get();
+    fast.get();
+    pool.disable_watchdog();
+
+    // 长任务只上报一次，并且带有调用栈
+    {
+        std::lock_guard<std::mutex> lock(reports_mutex);
+        assert(reports.size() == 1);
+        assert(reports[0].label == "hang");
+        assert(reports[0].elapsed >= std::chrono::milliseconds(20));
+        assert(!reports[0].stack.empty());
+        assert(pool.get_statistics().stuck_tasks == 1);
+    }
+
+    // 并发启用互相替换，不会覆盖仍可 join 的线程
+    std::vector<std::thread> enablers;
+    for (int i = 0; i < 4; ++i)
+    {
+        enablers.emplace_back([&pool]
+                              { pool.enable_watchdog(std::chrono::milliseconds(20), [](const ThreadPool::StuckTaskReport &) {}); });
+    }
+    for (auto &t : enablers)
+    {
+        t.join();
+    }
+
+    // 关闭后不能再启用
+    pool.shutdown();
+    bool threw = false;
+    try
+    {
+        pool.enable_watchdog(std::chrono::milliseconds(20), [](const ThreadPool::StuckTaskReport &) {});
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_lazy_start()
+{
+    ThreadPool::Options options;
+    options.threads = 8;
+    options.lazy_start = true;
+    options.stack_prefault_bytes = 256 * 1024;
+    options.lock_stack = true;
+    ThreadPool pool(options);
+
+    // 构造时不创建线程，只为实际需要的任务创建
+    assert(pool.size() == 8);
+    assert(pool.live_threads() == 0);
+
+    auto result = pool.submit(0, std::chrono::milliseconds::max(), []
+                              { return 1; });
+    assert(result.get() == 1);
+    assert(pool.live_threads() == 1);
+
+    // 顺序提交的任务复用同一个空闲线程（留出时间让线程回到等待状态）
+    for (int i = 0; i < 5; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pool.submit(0, std::chrono::milliseconds::max(), [] {}).get();
+    }
+    assert(pool.live_threads() == 1);
+
+    pool.warm_up();
+    assert(pool.live_threads() == 8);
+}
+
+/**
+ * @brief 异步读写：io_uring 和阻塞线程两种后端，续延在 CPU 线程池中执行
+ */
+void test_io_executor(bool use_io_uring)
+{
+    char path[] = "/tmp/thread_pool_io_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+
+    {
+        ThreadPool pool(1);
+        IoExecutor io(pool, 8, use_io_uring);
+        // 内核不支持 io_uring 时自动退化为阻塞线程
+        assert(use_io_uring || !io.using_io_uring());
+
+        std::vector<char> data(200000);
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] = static_cast<char>(i % 251);
+        }
+        assert(io.async_write(fd, data, 0).get() == data.size());
+
+        auto sum = io.async_read(fd, data.size(), 0, [](std::vector<char> bytes)
+                                 {
+            long long total = 0;
+            for (char c : bytes)
+            {
+                total += static_cast<unsigned char>(c);
+            }
+            return total; });
+        long long expected = 0;
+        for (char c : data)
+        {
+            expected += static_cast<unsigned char>(c);
+        }
+        assert(sum.get() == expected);
+
+        // 读到文件末尾时返回的数据较短
+        assert(io.async_read(fd, 100, static_cast<off_t>(data.size()) - 10).get().size() == 10);
+
+        // 唯一的工作线程等待 I/O 结果时协助执行续延任务，不会死锁
+        auto nested = pool.submit(0, std::chrono::milliseconds::max(), [&io, fd]()
+                                  { return io.async_read(fd, 4, 1).get(); });
+        std::vector<char> head = nested.get();
+        assert(head.size() == 4 && head[0] == 1 && head[3] == 4);
+
+        // 并发请求超过 queue_depth 时提交方排队
+        std::vector<ThreadPool::TaskFuture<std::vector<char>>> reads;
+        for (int i = 0; i < 32; ++i)
+        {
+            reads.push_back(io.async_read(fd, 16, i * 16));
+        }
+        for (int i = 0; i < 32; ++i)
+        {
+            assert(reads[i].get()[0] == static_cast<char>((i * 16) % 251));
+        }
+
+        // I/O 错误以 std::system_error 抛出
+        bool failed = false;
+        try
+        {
+            io.async_read(-1, 16, 0).get();
+        }
+        catch (const std::system_error &e)
+        {
+            failed = e.code().value() == EBADF;
+        }
+        assert(failed);
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief epoll 事件循环：边沿/水平触发、同一描述符回调串行、定时器
+ */
+void test_reactor()
+{
+    ThreadPool pool(2);
+    Reactor reactor(pool);
+    assert(!reactor.error());
+
+    // 大量连接由一个事件循环线程监视，边沿触发的回调读空数据
+    const int connections = 100;
+    std::vector<std::array<int, 2>> pairs(connections);
+    std::atomic<int> received{0};
+    // 每个描述符各自的并发回调数，同一描述符的回调不应重叠
+    std::vector<std::atomic<int>> concurrent(connections);
+    std::atomic<bool> overlapped{false};
+    for (int i = 0; i < connections; ++i)
+    {
+        int sv[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+        pairs[i] = {sv[0], sv[1]};
+        int fd = sv[1];
+        std::atomic<int> &running = concurrent[i];
+        reactor.add(fd, EPOLLIN | EPOLLET, [fd, &received, &running, &overlapped](uint32_t)
+                    {
+            if (running.fetch_add(1) != 0)
+            {
+                overlapped = true;
+            }
+            char buffer[64];
+            ssize_t n;
+            while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+            {
+                received += static_cast<int>(n);
+            }
+            running.fetch_sub(1); });
+    }
+    assert(reactor.watched() == connections);
+
+    for (int round = 0; round < 3; ++round)
+    {
+        for (auto &fds : pairs)
+        {
+            assert(write(fds[0], "ping", 4) == 4);
+        }
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (received < connections * 12 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(received == connections * 12);
+
+    for (auto &fds : pairs)
+    {
+        assert(reactor.remove(fds[1]));
+        close(fds[0]);
+        close(fds[1]);
+    }
+    assert(reactor.watched() == 0);
+
+    // 水平触发：每次只读一个字节，回调返回后重新监视，直到数据读完
+    {
+        int sv[2];
+        assert(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+        std::atomic<int> calls{0};
+        int fd = sv[1];
+        reactor.add(fd, EPOLLIN, [fd, &calls](uint32_t events)
+                    {
+            assert(events & EPOLLIN);
+            char c;
+            assert(read(fd, &c, 1) == 1);
+            calls++; });
+        assert(write(sv[0], "abc", 3) == 3);
+
+        deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (calls < 3 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        assert(calls == 3);
+        reactor.remove(fd);
+        close(sv[0]);
+        close(sv[1]);
+    }
+    assert(!overlapped);
+
+    // 定时器：一次性、周期性和取消
+    std::promise<void> fired;
+    auto start = std::chrono::steady_clock::now();
+    reactor.add_timer(std::chrono::milliseconds(20), [&fired]()
+                      { fired.set_value(); });
+    fired.get_future().wait();
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(20));
+
+    std::atomic<int> ticks{0};
+    auto periodic = reactor.add_timer(std::chrono::milliseconds(5), [&ticks]()
+                                      { ticks++; },
+                                      std::chrono::milliseconds(5));
+    auto cancelled = reactor.add_timer(std::chrono::milliseconds(10), []()
+                                       { assert(false); });
+    assert(reactor.cancel_timer(cancelled));
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (ticks < 3 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(ticks >= 3);
+    assert(reactor.cancel_timer(periodic));
+    assert(!reactor.cancel_timer(periodic));
+}
+
+/**
+ * @brief 纤程：大量阻塞的纤程复用少量工作线程，互斥锁、条件变量和通道
+ */
+void test_fibers()
+{
+    ThreadPool pool(2);
+
+    // 两万个纤程同时阻塞在条件变量上，只占用两个工作线程
+    {
+        FiberScheduler scheduler(pool, 16 * 1024, false);
+        FiberMutex mutex;
+        FiberConditionVariable cv;
+        bool go = false;
+        int waiting = 0;
+        std::atomic<int> woken{0};
+
+        const int fibers = 20000;
+        for (int i = 0; i < fibers; ++i)
+        {
+            scheduler.spawn([&]()
+                            {
+                std::unique_lock<FiberMutex> lock(mutex);
+                waiting++;
+                cv.wait(lock, [&go]
+                        { return go; });
+                woken++; });
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        for (;;)
+        {
+            {
+                std::unique_lock<FiberMutex> lock(mutex);
+                if (waiting == fibers || std::chrono::steady_clock::now() > deadline)
+                {
+                    go = true;
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(waiting == fibers);
+        assert(scheduler.active() == static_cast<size_t>(fibers));
+        cv.notify_all();
+        scheduler.wait_all();
+        assert(woken == fibers);
+    }
+
+    // 互斥锁保护的计数器，持锁期间让出
+    {
+        FiberScheduler scheduler(pool);
+        FiberMutex mutex;
+        long long counter = 0;
+        for (int i = 0; i < 100; ++i)
+        {
+            scheduler.spawn([&]()
+                            {
+                for (int j = 0; j < 100; ++j)
+                {
+                    std::unique_lock<FiberMutex> lock(mutex);
+                    long long value = counter;
+                    FiberScheduler::yield();
+                    counter = value + 1;
+                } });
+        }
+        scheduler.wait_all();
+        assert(counter == 10000);
+        assert(scheduler.switches() > 10000);
+    }
+
+    // 有界通道：生产者多于通道容量时挂起，关闭后消费者退出
+    {
+        FiberScheduler scheduler(pool);
+        FiberChannel<int> channel(4);
+        std::atomic<long long> sum{0};
+        std::atomic<int> producers{10};
+        for (int p = 0; p < 10; ++p)
+        {
+            scheduler.spawn([&, p]()
+                            {
+                for (int i = 1; i <= 100; ++i)
+                {
+                    bool pushed = channel.push(p * 1000 + i);
+                    assert(pushed);
+                }
+                if (--producers == 0)
+                {
+                    channel.close();
+                } });
+        }
+        for (int c = 0; c < 3; ++c)
+        {
+            scheduler.spawn([&]()
+                            {
+                while (auto value = channel.pop())
+                {
+                    sum += *value;
+                } });
+        }
+        scheduler.spawn([]()
+                        { throw std::runtime_error("fiber failure"); });
+        scheduler.wait_all();
+
+        long long expected = 0;
+        for (int p = 0; p < 10; ++p)
+        {
+            expected += p * 1000 * 100 + 5050;
+        }
+        assert(sum == expected);
+        bool pushed_after_close = channel.push(1);
+        assert(!pushed_after_close);
+        assert(scheduler.failed() == 1);
+    }
+
+    // 线程池已停止时 spawn 抛出，纤程不计入活动数，wait_all 不会卡住
+    {
+        ThreadPool stopped(1);
+        FiberScheduler scheduler(stopped);
+        stopped.shutdown();
+        bool threw = false;
+        try
+        {
+            scheduler.spawn([] {});
+        }
+        catch (const std::runtime_error &)
+        {
+            threw = true;
+        }
+        assert(threw);
+        assert(scheduler.active() == 0);
+        scheduler.wait_all();
+    }
+}
+
+/**
+ * @brief 小任务合并：按窗口和批大小合并，每个元素有自己的 future
+ */
+void test_task_coalescer()
+{
+    ThreadPool pool(2);
+
+    {
+        std::atomic<size_t> largest{0};
+        TaskCoalescer<int, int> doubler(
+            pool, [&largest](std::vector<int> &items)
+            {
+                size_t size = items.size();
+                size_t previous = largest.load();
+                while (size > previous && !largest.compare_exchange_weak(previous, size))
+                {
+                }
+                std::vector<int> results;
+                for (int item : items)
+                {
+                    results.push_back(item * 2);
+                }
+                return results; },
+            64, std::chrono::milliseconds(1));
+
+        std::vector<ThreadPool::TaskFuture<int>> futures;
+        for (int i = 0; i < 1000; ++i)
+        {
+            futures.push_back(doubler.submit(i));
+        }
+        for (int i = 0; i < 1000; ++i)
+        {
+            assert(futures[i].get() == i * 2);
+        }
+        assert(doubler.items() == 1000);
+        assert(doubler.batches() >= 1000 / 64 && doubler.batches() < 1000);
+        assert(largest <= 64);
+
+        // 工作线程中等待元素结果时协助执行，不会死锁
+        auto nested = pool.submit(0, std::chrono::milliseconds::max(), [&doubler]()
+                                  { return doubler.submit(21).get(); });
+        assert(nested.get() == 42);
+    }
+
+    // 批处理函数的异常传给该批次的每个元素
+    {
+        std::atomic<int> applied{0};
+        TaskCoalescer<int, void> updater(
+            pool, [&applied](std::vector<int> &items)
+            {
+                for (int item : items)
+                {
+                    if (item < 0)
+                    {
+                        throw std::invalid_argument("negative entry");
+                    }
+                }
+                applied += static_cast<int>(items.size()); },
+            16, std::chrono::microseconds(0));
+
+        auto ok = updater.submit(1);
+        ok.get();
+        assert(applied == 1);
+
+        updater.submit(2).get();
+        bool thrown = false;
+        try
+        {
+            updater.submit(-1).get();
+        }
+        catch (const std::invalid_argument &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+}
+
+/**
+ * @brief 优先级继承：高优先级任务等待时，被等待的低优先级任务（及等待链）插到中优先级任务之前
+ */
+void test_priority_inheritance()
+{
+    ThreadPool pool(1);
+    ThreadPool other(1);
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    auto record = [&order_mutex, &order](const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(name);
+    };
+    auto wait_for_priority = [](auto &future, int priority)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (future.priority() < priority && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        assert(future.priority() == priority);
+    };
+
+    // 唯一的工作线程被占住时，低优先级任务排在中优先级任务之后
+    {
+        std::promise<void> gate;
+        std::shared_future<void> opened = gate.get_future().share();
+        std::atomic<bool> blocked{false};
+        pool.submit(100, std::chrono::milliseconds::max(), [opened, &blocked]()
+                    {
+            blocked = true;
+            opened.wait(); });
+        while (!blocked)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto low = pool.submit(1, std::chrono::milliseconds::max(), [&record]()
+                               { record("low"); });
+        std::vector<ThreadPool::TaskFuture<void>> mids;
+        for (int i = 0; i < 3; ++i)
+        {
+            mids.push_back(pool.submit(5, std::chrono::milliseconds::max(), [&record]()
+                                       { record("mid"); }));
+        }
+
+        // 另一个线程池中优先级为 9 的任务等待 low
+        auto high = other.submit(9, std::chrono::milliseconds::max(), [&low]()
+                                 { low.get(); });
+        wait_for_priority(low, 9);
+
+        gate.set_value();
+        high.get();
+        for (auto &mid : mids)
+        {
+            mid.get();
+        }
+        assert(order.size() == 4 && order[0] == "low");
+    }
+
+    // 等待链：B 正在执行并等待尚未入队的 D，等待 B 的高优先级任务把 D 也提升
+    {
+        order.clear();
+        ThreadPool::TaskOptions low_options;
+        low_options.priority = 1;
+        auto deferred = pool.defer(low_options, [&record]()
+                                   { record("D"); });
+
+        std::atomic<bool> started{false};
+        auto d_future = std::make_shared<ThreadPool::TaskFuture<void>>(std::move(deferred.future));
+        auto b = pool.submit(1, std::chrono::milliseconds::max(), [&record, &started, d_future]()
+                             {
+            started = true;
+            d_future->get();
+            record("B"); });
+        while (!started)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // 暂停调度，保证中优先级任务在 D 入队前不会被 B 协助执行
+        pool.pause();
+        std::vector<ThreadPool::TaskFuture<void>> mids;
+        for (int i = 0; i < 3; ++i)
+        {
+            mids.push_back(pool.submit(5, std::chrono::milliseconds::max(), [&record]()
+                                       { record("mid"); }));
+        }
+
+        auto high = other.submit(9, std::chrono::milliseconds::max(), [&b]()
+                                 { b.get(); });
+        wait_for_priority(b, 9);
+        wait_for_priority(*d_future, 9);
+
+        deferred.release();
+        pool.resume();
+        high.get();
+        for (auto &mid : mids)
+        {
+            mid.get();
+        }
+        assert(order.size() == 5 && order[0] == "D" && order[1] == "B");
+        assert(pool.get_statistics().priority_boosts >= 3);
+    }
+}
+
+void test_consistent_statistics()
+{
+    ThreadPool pool(4);
+    std::atomic<bool> stop_sampling{false};
+    std::atomic<int> samples{0};
+
+    // 并发采样：每个快照的计数必须守恒，且结束计数单调不减
+    std::thread sampler([&]()
+                        {
+        uint64_t last_finished = 0;
+        while (!stop_sampling)
+        {
+            auto stats = pool.get_statistics();
+            uint64_t finished = stats.completed_tasks + stats.failed_tasks +
+                                stats.timeout_tasks + stats.cancelled_tasks;
+            assert(stats.submitted_tasks == stats.pending_tasks + stats.running_tasks + finished);
+            assert(stats.running_tasks <= 4);
+            assert(finished >= last_finished);
+            last_finished = finished;
+            samples++;
+        } });
+
+    const int count = 2000;
+    std::vector<ThreadPool::TaskFuture<void>> futures;
+    for (int i = 0; i < count; ++i)
+    {
+        futures.push_back(pool.submit(0, std::chrono::milliseconds::max(), [i]()
+                                      {
+            if (i % 10 == 0)
+            {
+                throw std::runtime_error("expected failure");
+            } }));
+        if (i % 100 == 1)
+        {
+            futures.back().cancel();
+        }
+    }
+
+    // 快照同时覆盖待认领和执行中的任务，wait_all 返回时计数已全部落定
+    assert(pool.wait_all(std::chrono::milliseconds(5000)));
+    auto stats = pool.get_statistics();
+    assert(stats.pending_tasks == 0 && stats.running_tasks == 0);
+    assert(stats.submitted_tasks == count);
+    assert(stats.completed_tasks + stats.failed_tasks + stats.cancelled_tasks == count);
+    assert(stats.cancelled_tasks <= count / 100);
+
+    stop_sampling = true;
+    sampler.join();
+    assert(samples > 0);
+}
+
+void test_cache_padded()
+{
+    static_assert(alignof(CachePadded<char>) == cache_line_size, "CachePadded must be line aligned");
+    static_assert(sizeof(CachePadded<std::atomic<uint64_t>>) == cache_line_size, "CachePadded must fill a line");
+
+    // 相邻元素落在不同的缓存行
+    CachePadded<std::atomic<uint64_t>> counters[2] = {CachePadded<std::atomic<uint64_t>>(1),
+                                                      CachePadded<std::atomic<uint64_t>>(2)};
+    auto first = reinterpret_cast<uintptr_t>(&*counters[0]);
+    auto second = reinterpret_cast<uintptr_t>(&*counters[1]);
+    assert(first / cache_line_size != second / cache_line_size);
+    counters[1]->fetch_add(1);
+    assert(*counters[0] == 1 && *counters[1] == 3);
+
+    // 构造函数是显式的，非 const 左值走拷贝构造而不是转发给 T
+    static_assert(!std::is_convertible_v<int, CachePadded<int>>, "CachePadded must not convert implicitly");
+    static_assert(std::is_constructible_v<CachePadded<int>, int>, "CachePadded must construct from T's arguments");
+    static_assert(!std::is_constructible_v<CachePadded<int>, std::string>, "CachePadded must reject bad arguments");
+    CachePadded<std::string> original(std::string("padded"));
+    CachePadded<std::string> copy(original);
+    assert(*copy == "padded" && *original == "padded");
+}
+
+int main()
+{
+    test_submit_and_statistics();
+    test_nested_wait_does_not_deadlock();
+    test_cancel();
+    test_tracing();
+    test_timing();
+    test_shutdown_drain_deadline();
+    test_shutdown_cancel_pending();
+    test_shutdown_immediate();
+    test_pause_resume();
+    test_resize();
+    test_weighted_tenants();
+    test_tenant_concurrency_cap();
+    test_watchdog();
+    test_lazy_start();
+    test_io_executor(true);
+    test_io_executor(false);
+    test_reactor();
+    test_fibers();
+    test_task_coalescer();
+    test_priority_inheritance();
+    test_consistent_statistics();
+    test_cache_padded();
+
+    std::cout << "All tests passed!\n";
+    return 0;
+}